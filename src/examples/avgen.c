@@ -35,6 +35,7 @@ video_generator gen;
 uint8_t must_run = 1;
 uint64_t goal_frame = 30;
 uint64_t goal_copy = 30;
+FILE* audio_fp = NULL;
 
 /* ----------------------------------------------------------------------------------- */
 
@@ -52,27 +53,18 @@ int main() {
   cfg.bip_frequency = 500;
   cfg.bop_frequency = 1500;
 
-  if (0 != video_generator_init(&cfg, &gen)) {
-    printf("Error: cannot initialize the video generator.\n");
-    exit(EXIT_FAILURE);
-  }
-
-  /* Write raw audio block to a file. This chunk will be repeadetly used while running. */
-  FILE* fp = fopen("out_s16_44100_stereo.pcm", "wb");
-  if (!fp) {
+  /* The raw audio is written from the audio callback. */
+  audio_fp = fopen("out_s16_44100_stereo.pcm", "wb");
+  if (!audio_fp) {
     printf("Error: cannot open pcm output file.\n");
     exit(EXIT_FAILURE);
   }
 
-  if (1 != fwrite(gen.audio_buffer, gen.audio_nbytes, 1, fp)) {
-    printf("Error: failed to write the audio block.\n");
+  if (0 != video_generator_init(&cfg, &gen)) {
+    printf("Error: cannot initialize the video generator.\n");
     exit(EXIT_FAILURE);
   }
 
-  if (0 != fclose(fp)) {
-    printf("Error: failed to close the audio example file.\n");
-  }
-
   /* Write video to a raw yuv file. */
   video_fp = fopen("out_yuv420p_320x240.yuv", "wb");
   if (!video_fp) {
@@ -98,6 +90,10 @@ int main() {
 
   video_generator_clear(&gen);
 
+  if (0 != fclose(audio_fp)) {
+    printf("Error: failed to close the audio example file.\n");
+  }
+
   if (0 != fclose(video_fp)) {
     printf("Error: failed to close the video file correctly.\n");
   }
@@ -117,6 +113,9 @@ static void on_sigh(int s) {
 static void on_audio(const int16_t* samples, uint64_t nbytes, uint32_t nframes) {
   total_audio_frames += nframes; /* this can be used for our timebase */
   total_nbytes += nbytes;
+  if (1 != fwrite(samples, (size_t)nbytes, 1, audio_fp)) {
+    printf("Error: failed to write the audio samples.\n");
+  }
   now = (uint64_t)((1.0 / 44100.0) * 1e9) * total_audio_frames; /* not used in this example but this could be used as your timebase. */
   goal_frame = (uint64_t)((double)now / ((double)gen.fps * 1e3)); /* set the goal frame up to which we have to generate frames. */
 }
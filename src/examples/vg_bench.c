@@ -0,0 +1,1028 @@
+/* VideoGenerator
+ * Copyright (C) 2024 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+  vg_bench
+  ========
+
+  Times the generator for every combination of format, bitdepth, byte
+  order, `onecolor` and resolution and writes the results as JSON. Each
+  case is measured three times:
+
+  update        - `video_generator_update()`, which only repaints what
+                  changed since the previous frame.
+  render_frame  - `video_generator_render_frame()`, which draws the
+                  complete frame (background, bar and text box).
+  update_n      - `video_generator_update_n()` with `--batch` frames
+                  per call; the latency of a frame is the time of the
+                  call divided by the number of frames.
+
+  With `onecolor` set all three only run the fill kernels over the
+  complete frame. `--pattern` replaces the bars with one of the stress
+  patterns, the `onecolor` cases are skipped then. `frame_gbps` is the
+  frame equivalent throughput, i.e. `fps` times the size of a complete
+  frame; `update` only repaints a part of each frame so it writes less
+  than that. The latencies are per frame in microseconds.
+
+  Golden checksums
+  ----------------
+
+  With `--golden FILE` vg_bench checks that the optimized render paths
+  produce exactly the pixels of the scalar kernels instead. For every
+  format, bitdepth, byte order and pattern (and `onecolor` for the
+  bars) it renders GOLDEN_SEQ consecutive frames and the frames in
+  `golden_frames` with VIDEO_GENERATOR_SIMD_NONE on one thread and
+  hashes each plane with XXH64. Then every SIMD level the cpu supports
+  renders the same frames with `update()`, `update_n()` and
+  `render_frame()` on one and on GOLDEN_THREADS threads; each frame is
+  compared with the scalar one. The scalar digests of a case, chained
+  over all its frames, are compared with the line of the case in FILE
+  so a change of the scalar output is caught too. `--write-golden`
+  (re)writes FILE from the scalar output; only do that when the pixels
+  are supposed to change. The frames are GOLDEN_WIDTH x GOLDEN_HEIGHT,
+  which isn't a multiple of any vector width so the tails are covered.
+
+  The JSON then has one entry per case and SIMD level with the number
+  of mismatching frames and the speedup of `update()` and
+  `render_frame()` over the scalar kernels. The exit code is 1 when
+  anything doesn't match.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <video_generator.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include "getopt_long.h"
+#endif
+
+/* ----------------------------------------------------------------------------------- */
+
+#define MAX_CASES 16                            /* max number of values per dimension. */
+#define MAX_BATCH 64                            /* max number of frames per `video_generator_update_n()` call. */
+#define GOLDEN_WIDTH 646
+#define GOLDEN_HEIGHT 362
+#define GOLDEN_SEQ 16                           /* number of consecutive frames that `update()` renders. */
+#define GOLDEN_THREADS 4
+#define GOLDEN_BATCH 4                          /* frames per `video_generator_update_n()` call. */
+#define GOLDEN_MAX_FRAMES 32
+#define GOLDEN_MAX_CASES 256
+
+/* The XXH64 digests of the planes of one frame, 0 for a plane that the format doesn't have. */
+typedef struct golden_digest {
+  uint64_t plane[3];
+} golden_digest;
+
+/* The scalar reference of one case. */
+typedef struct golden_case {
+  video_generator_settings cfg;
+  golden_digest frames[GOLDEN_MAX_FRAMES];      /* the digests of `golden_frame()` 0 .. `golden_nframes()` - 1. */
+  golden_digest chained;                        /* the digests chained over all frames, what is stored in the golden file. */
+} golden_case;
+
+typedef struct bench_result {
+  uint32_t nframes;
+  double   seconds;                             /* total time of all frames. */
+  uint64_t* latencies;                          /* per frame, in nanoseconds. */
+} bench_result;
+
+static uint32_t nframes = 30;
+static uint32_t nthreads = 0;
+static uint32_t nbatch = 8;
+static uint8_t pattern = VIDEO_GENERATOR_PATTERN_BARS;
+static uint32_t heights[MAX_CASES] = { 480, 720, 1080, 2160, 4320 };
+static uint32_t nheights = 5;
+static uint32_t formats[MAX_CASES] = { 400, 420, 422, 444, VIDEO_GENERATOR_FORMAT_NV12 };
+static uint32_t nformats = 5;
+static uint32_t bitdepths[MAX_CASES] = { 8, 10, 12 };
+static uint32_t nbitdepths = 3;
+static char* filename = NULL;
+static char* golden_file = NULL;
+static uint8_t golden_write = 0;
+static const uint64_t golden_frames[] = { 24, 25, 26, 50, 124, 125, 126, 249, 1499, 1500, 89999, 90000 }; /* bar wraps, bips, seconds, minutes and the hour. */
+
+static uint64_t now_ns(void);
+static int compare_u64(const void* a, const void* b);
+static uint32_t parse_list(const char* str, uint32_t* out);
+static const char* format_name(uint32_t format, uint32_t bitdepth);
+static const char* pattern_name(uint8_t pattern);
+static int bench_update(video_generator* g, bench_result* r);
+static int bench_render_frame(video_generator* g, bench_result* r);
+static int bench_update_n(video_generator* g, bench_result* r);
+static void print_result(FILE* fp, int* first, video_generator_settings* s, const char* mode, video_generator* g, bench_result* r);
+static int golden_run(FILE* fp);
+static uint32_t golden_cases(golden_case* cases);
+static int golden_reference(golden_case* c);
+static int golden_check(golden_case* c, uint8_t simd, uint32_t threads, const char* path, double* seconds);
+static int golden_compare_file(golden_case* cases, uint32_t ncases);
+static int golden_write_file(golden_case* cases, uint32_t ncases);
+static void golden_key(video_generator_settings* s, char* key, size_t nbytes);
+static uint32_t golden_nframes(void);
+static uint64_t golden_frame(uint32_t i);
+static void golden_hash_frame(video_generator* g, uint8_t* planes[3], golden_digest* d);
+static int golden_match(video_generator_settings* s, uint8_t simd, uint32_t threads, const char* path, uint64_t frame, golden_digest* ref, golden_digest* d);
+static const char* simd_name(uint8_t simd);
+static uint64_t xxh64(const void* data, size_t len, uint64_t seed);
+
+#ifndef _WIN32
+void usage(char *progname) {
+    printf("Usage: %s [options...]\n", progname);
+
+    printf("\n");
+    printf("Options:\n");
+    printf("    -h, --help          show this help\n");
+    printf("    -n, --frames        number of timed frames per case, default 30\n");
+    printf("    -t, --threads       number of render threads\n");
+    printf("    -B, --batch         frames per video_generator_update_n() call, default 8\n");
+    printf("    -H, --heights       comma separated frame heights, default 480,720,1080,2160,4320\n");
+    printf("    -F, --formats       comma separated formats, default 400,420,422,444,nv12\n");
+    printf("    -b, --bitdepths     comma separated bitdepths, default 8,10,12\n");
+    printf("    -P, --pattern       bars (default), noise, gradient or zoneplate\n");
+    printf("    -o, --output        write the JSON into this file instead of stdout\n");
+    printf("    -G, --golden        check all SIMD levels and threaded paths against the scalar output and this digest file\n");
+    printf("        --write-golden  write the digest file of --golden from the scalar output\n");
+}
+
+int parse_options(int argc, char **argv) {
+
+    static struct option long_options[] = {
+        {"help",      no_argument,        NULL, 'h'},
+        {"frames",    required_argument,  NULL, 'n'},
+        {"threads",   required_argument,  NULL, 't'},
+        {"batch",     required_argument,  NULL, 'B'},
+        {"heights",   required_argument,  NULL, 'H'},
+        {"formats",   required_argument,  NULL, 'F'},
+        {"bitdepths", required_argument,  NULL, 'b'},
+        {"output",    required_argument,  NULL, 'o'},
+        {"pattern",   required_argument,  NULL, 'P'},
+        {"golden",    required_argument,  NULL, 'G'},
+        {"write-golden", no_argument,     NULL, 'w'},
+        {NULL,        0,                  NULL,   0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv,
+                              "+hn:t:B:H:F:b:o:P:G:",
+                              long_options, NULL)) > 0) {
+        switch (opt) {
+            default:
+                usage(argv[0]);
+                exit(1);
+            case 'h':
+                usage(argv[0]);
+                exit(0);
+            case 'n':
+                nframes = (uint32_t)atoi(optarg);
+                break;
+            case 't':
+                nthreads = (uint32_t)atoi(optarg);
+                break;
+            case 'B':
+                nbatch = (uint32_t)atoi(optarg);
+                break;
+            case 'H':
+                nheights = parse_list(optarg, heights);
+                break;
+            case 'F':
+                nformats = parse_list(optarg, formats);
+                break;
+            case 'b':
+                nbitdepths = parse_list(optarg, bitdepths);
+                break;
+            case 'o':
+                filename = strdup(optarg);
+                break;
+            case 'G':
+                free(golden_file);
+                golden_file = strdup(optarg);
+                break;
+            case 'w':
+                golden_write = 1;
+                break;
+            case 'P':
+                for (pattern = VIDEO_GENERATOR_PATTERN_BARS; pattern <= VIDEO_GENERATOR_PATTERN_ZONEPLATE; ++pattern) {
+                    if (0 == strcmp(optarg, pattern_name(pattern))) {
+                        break;
+                    }
+                }
+                if (pattern > VIDEO_GENERATOR_PATTERN_ZONEPLATE) {
+                    usage(argv[0]);
+                    exit(1);
+                }
+                break;
+        }
+    }
+
+    if (golden_write && NULL == golden_file) {
+        usage(argv[0]);
+        exit(1);
+    }
+
+    if (0 == nframes || 0 == nheights || 0 == nformats || 0 == nbitdepths || 0 == nbatch || nbatch > MAX_BATCH) {
+        usage(argv[0]);
+        exit(1);
+    }
+
+    return 0;
+}
+#endif
+
+int main(int argc, char** argv) {
+
+  video_generator_settings cfg;
+  video_generator gen;
+  bench_result r;
+  FILE* fp = stdout;
+  uint32_t hi, fi, bi, byte_order, onecolor;
+  int first = 1;
+  int res = 0;
+
+#ifndef _WIN32
+  parse_options(argc, argv);
+#else
+  (void)argc;
+  (void)argv;
+#endif
+
+  r.latencies = (uint64_t*)malloc(sizeof(uint64_t) * nframes);
+  if (!r.latencies) {
+    printf("Error: cannot allocate the latency buffer.\n");
+    exit(1);
+  }
+
+  if (filename) {
+    fp = fopen(filename, "w");
+    if (!fp) {
+      printf("Error: cannot open %s.\n", filename);
+      exit(1);
+    }
+  }
+
+  if (NULL != golden_file) {
+    res = golden_run(fp);
+    if (fp != stdout) {
+      fclose(fp);
+    }
+    free(r.latencies);
+    free(filename);
+    free(golden_file);
+    return (0 == res) ? 0 : 1;
+  }
+
+  fprintf(fp, "{\n  \"frames_per_case\": %u,\n  \"threads\": %u,\n  \"results\": [", nframes, nthreads);
+
+  for (hi = 0; hi < nheights && 0 == res; ++hi) {
+    for (fi = 0; fi < nformats && 0 == res; ++fi) {
+      for (bi = 0; bi < nbitdepths && 0 == res; ++bi) {
+        for (byte_order = 0; byte_order < 2 && 0 == res; ++byte_order) {
+
+          /* the byte order only matters for samples of 2 bytes. */
+          if (8 == bitdepths[bi] && BYTE_ORDER_BIG_ENDIAN == byte_order) {
+            continue;
+          }
+
+          for (onecolor = 0; onecolor < 2 && 0 == res; ++onecolor) {
+
+            if (1 == onecolor && VIDEO_GENERATOR_PATTERN_BARS != pattern) {
+              continue;
+            }
+
+            memset(&cfg, 0x00, sizeof(cfg));
+            cfg.height = heights[hi];
+            cfg.width = (heights[hi] * 16) / 9;
+            cfg.fps = 25;
+            cfg.format = formats[fi];
+            cfg.bitdepth = (uint8_t)bitdepths[bi];
+            cfg.byte_order = (uint8_t)byte_order;
+            cfg.onecolor = (uint8_t)onecolor;
+            cfg.pattern = pattern;
+            cfg.nthreads = nthreads;
+            cfg.pool_size = nbatch;
+
+            fprintf(stderr, "%ux%u %s %s onecolor=%u\n", cfg.width, cfg.height, format_name(cfg.format, cfg.bitdepth),
+                    (BYTE_ORDER_BIG_ENDIAN == byte_order) ? "be" : "le", onecolor);
+
+            if (0 != (res = video_generator_init(&cfg, &gen))) {
+              printf("Error: cannot initialize the generator %d.\n", res);
+              break;
+            }
+
+            if (0 == (res = bench_update(&gen, &r))) {
+              print_result(fp, &first, &cfg, "update", &gen, &r);
+            }
+            if (0 == res && 0 == (res = bench_render_frame(&gen, &r))) {
+              print_result(fp, &first, &cfg, "render_frame", &gen, &r);
+            }
+            if (0 == res && 0 == (res = bench_update_n(&gen, &r))) {
+              print_result(fp, &first, &cfg, "update_n", &gen, &r);
+            }
+
+            video_generator_clear(&gen);
+          }
+        }
+      }
+    }
+  }
+
+  fprintf(fp, "\n  ]\n}\n");
+
+  if (fp != stdout) {
+    fclose(fp);
+  }
+
+  free(r.latencies);
+  free(filename);
+
+  return (0 == res) ? 0 : 1;
+}
+
+static int bench_update(video_generator* g, bench_result* r) {
+
+  uint64_t start, end, total = 0;
+  uint32_t i;
+
+  /* the first frame copies the complete background, we want the steady state. */
+  if (0 != video_generator_update(g)) {
+    return -1;
+  }
+
+  for (i = 0; i < nframes; ++i) {
+    start = now_ns();
+    if (0 != video_generator_update(g)) {
+      return -1;
+    }
+    end = now_ns();
+    r->latencies[i] = end - start;
+    total += end - start;
+  }
+
+  r->nframes = nframes;
+  r->seconds = (double)total / 1e9;
+
+  return 0;
+}
+
+static int bench_render_frame(video_generator* g, bench_result* r) {
+
+  uint64_t start, end, total = 0;
+  uint8_t* planes[3];
+  uint8_t* buf;
+  uint32_t i;
+  int res = 0;
+
+  buf = (uint8_t*)malloc(g->nbytes);
+  if (!buf) {
+    printf("Error: cannot allocate the frame buffer.\n");
+    return -1;
+  }
+
+  /* touch the buffer once so we don't measure page faults. */
+  memset(buf, 0x00, g->nbytes);
+
+  planes[0] = buf;
+  planes[1] = buf + g->ybytes;
+  planes[2] = buf + g->ybytes + g->ubytes;
+
+  for (i = 0; i < nframes; ++i) {
+    start = now_ns();
+    if (0 != video_generator_render_frame(g, i, planes)) {
+      res = -1;
+      break;
+    }
+    end = now_ns();
+    r->latencies[i] = end - start;
+    total += end - start;
+  }
+
+  r->nframes = nframes;
+  r->seconds = (double)total / 1e9;
+
+  free(buf);
+
+  return res;
+}
+
+static int bench_update_n(video_generator* g, bench_result* r) {
+
+  video_generator_frame* frames[MAX_BATCH];
+  uint64_t start, end, total = 0;
+  uint32_t i, k, n;
+  int res = 0;
+
+  /* like `bench_update()` the first call, which copies the complete backgrounds into the pool buffers, isn't timed. */
+  memset(frames, 0x00, sizeof(frames));
+  if (0 != video_generator_update_n(g, nbatch, frames)) {
+    return -1;
+  }
+
+  for (i = 0; i < nframes && 0 == res; i += n) {
+    n = (nframes - i < nbatch) ? nframes - i : nbatch;
+    for (k = 0; k < nbatch; ++k) {
+      video_generator_release_frame(g, frames[k]);
+      frames[k] = NULL;
+    }
+    start = now_ns();
+    if (0 != video_generator_update_n(g, n, frames)) {
+      res = -1;
+      break;
+    }
+    end = now_ns();
+    for (k = 0; k < n; ++k) {
+      r->latencies[i + k] = (end - start) / n;
+    }
+    total += end - start;
+  }
+
+  r->nframes = nframes;
+  r->seconds = (double)total / 1e9;
+
+  return res;
+}
+
+static void print_result(FILE* fp, int* first, video_generator_settings* s, const char* mode, video_generator* g, bench_result* r) {
+
+  double fps = (r->seconds > 0.0) ? r->nframes / r->seconds : 0.0;
+  uint64_t* lat = r->latencies;
+  uint32_t n = r->nframes;
+
+  qsort(lat, n, sizeof(uint64_t), compare_u64);
+
+  /* nearest rank percentiles. */
+#define PERCENTILE(p) ((double)lat[((n * (p) + 99) / 100) - 1] / 1e3)
+
+  fprintf(fp, "%s\n    {\"mode\": \"%s\", \"width\": %u, \"height\": %u, \"format\": \"%s\", \"bitdepth\": %u, "
+          "\"byte_order\": \"%s\", \"onecolor\": %u, \"pattern\": \"%s\", \"frame_bytes\": %u, \"simd\": \"%s\", \"frames\": %u, "
+          "\"fps\": %.2f, \"frame_gbps\": %.3f, "
+          "\"latency_us\": {\"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}}",
+          (*first) ? "" : ",",
+          mode, s->width, s->height, format_name(s->format, s->bitdepth), s->bitdepth,
+          (BYTE_ORDER_BIG_ENDIAN == s->byte_order) ? "be" : "le", s->onecolor, pattern_name(s->pattern), g->nbytes, simd_name(g->simd), n,
+          fps, (fps * g->nbytes) / 1e9,
+          (double)lat[0] / 1e3, PERCENTILE(50), PERCENTILE(90), PERCENTILE(99), (double)lat[n - 1] / 1e3);
+
+#undef PERCENTILE
+
+  fflush(fp);
+  *first = 0;
+}
+
+/* ----------------------------------------------------------------------------------- */
+/*                          G O L D E N                                                */
+/* ----------------------------------------------------------------------------------- */
+
+static int golden_run(FILE* fp) {
+
+  static golden_case cases[GOLDEN_MAX_CASES];
+  static const uint32_t threads[] = { 1, GOLDEN_THREADS };
+  double t_update[2], t_render[2], t_scalar_update = 0.0, t_scalar_render = 0.0, seconds;
+  uint32_t ncases, i, ti;
+  uint8_t simd;
+  int mismatches, r, total = 0;
+  int first = 1;
+  int res = 0;
+
+  ncases = golden_cases(cases);
+
+  fprintf(fp, "{\n  \"golden\": \"%s\",\n  \"width\": %u,\n  \"height\": %u,\n  \"frames_per_case\": %u,\n  \"results\": [",
+          golden_file, GOLDEN_WIDTH, GOLDEN_HEIGHT, golden_nframes());
+
+  for (i = 0; i < ncases && 0 == res; ++i) {
+
+    if (0 != (res = golden_reference(&cases[i]))) {
+      break;
+    }
+
+    for (simd = VIDEO_GENERATOR_SIMD_NONE; simd <= VIDEO_GENERATOR_SIMD_NEON; ++simd) {
+
+      if (1 != video_generator_has_simd(simd)) {
+        continue;
+      }
+
+      /* an error isn't a mismatch, the timings of the case are incomplete then. */
+      mismatches = 0;
+      for (ti = 0; ti < 2 && 0 == res; ++ti) {
+        if (0 > (r = golden_check(&cases[i], simd, threads[ti], "update", &t_update[ti]))) {
+          res = -1;
+          break;
+        }
+        mismatches += r;
+        if (0 > (r = golden_check(&cases[i], simd, threads[ti], "update_n", &seconds))) {
+          res = -1;
+          break;
+        }
+        mismatches += r;
+        if (0 > (r = golden_check(&cases[i], simd, threads[ti], "render_frame", &t_render[ti]))) {
+          res = -1;
+          break;
+        }
+        mismatches += r;
+      }
+      if (0 != res) {
+        break;
+      }
+      if (VIDEO_GENERATOR_SIMD_NONE == simd) {
+        t_scalar_update = t_update[0];
+        t_scalar_render = t_render[0];
+      }
+      total += mismatches;
+
+      fprintf(fp, "%s\n    {\"format\": \"%s\", \"bitdepth\": %u, \"byte_order\": \"%s\", \"onecolor\": %u, \"pattern\": \"%s\", "
+              "\"simd\": \"%s\", \"mismatches\": %d, \"update_speedup\": %.2f, \"render_frame_speedup\": %.2f, "
+              "\"threaded_update_speedup\": %.2f, \"threaded_render_frame_speedup\": %.2f}",
+              (first) ? "" : ",",
+              format_name(cases[i].cfg.format, cases[i].cfg.bitdepth), cases[i].cfg.bitdepth,
+              (BYTE_ORDER_BIG_ENDIAN == cases[i].cfg.byte_order) ? "be" : "le", cases[i].cfg.onecolor,
+              pattern_name(cases[i].cfg.pattern), simd_name(simd), mismatches,
+              t_scalar_update / t_update[0], t_scalar_render / t_render[0],
+              t_scalar_update / t_update[1], t_scalar_render / t_render[1]);
+      fflush(fp);
+      first = 0;
+    }
+  }
+
+  if (0 == res) {
+    res = (golden_write) ? golden_write_file(cases, ncases) : golden_compare_file(cases, ncases);
+    total += (res > 0) ? res : 0;
+  }
+
+  fprintf(fp, "\n  ],\n  \"mismatches\": %d\n}\n", total);
+
+  if (res < 0) {
+    return res;
+  }
+
+  return (0 == total) ? 0 : 1;
+}
+
+/* Fills `cases` with every format, bitdepth, byte order and pattern combination of the options. */
+static uint32_t golden_cases(golden_case* cases) {
+
+  static const uint32_t all_bitdepths[] = { 8, 10, 12, 16 };
+  uint32_t fi, bi, byte_order, onecolor, n = 0;
+  uint8_t pat;
+
+  for (fi = 0; fi < nformats; ++fi) {
+    for (bi = 0; bi < 4; ++bi) {
+      for (byte_order = 0; byte_order < 2; ++byte_order) {
+
+        if (8 == all_bitdepths[bi] && BYTE_ORDER_BIG_ENDIAN == byte_order) {
+          continue;
+        }
+
+        for (pat = VIDEO_GENERATOR_PATTERN_BARS; pat <= VIDEO_GENERATOR_PATTERN_ZONEPLATE; ++pat) {
+          for (onecolor = 0; onecolor < 2; ++onecolor) {
+
+            if (1 == onecolor && VIDEO_GENERATOR_PATTERN_BARS != pat) {
+              continue;
+            }
+            if (n == GOLDEN_MAX_CASES) {
+              return n;
+            }
+
+            memset(&cases[n], 0x00, sizeof(cases[n]));
+            cases[n].cfg.width = GOLDEN_WIDTH;
+            cases[n].cfg.height = GOLDEN_HEIGHT;
+            cases[n].cfg.fps = 25;
+            cases[n].cfg.format = formats[fi];
+            cases[n].cfg.bitdepth = (uint8_t)all_bitdepths[bi];
+            cases[n].cfg.byte_order = (uint8_t)byte_order;
+            cases[n].cfg.onecolor = (uint8_t)onecolor;
+            cases[n].cfg.pattern = pat;
+            cases[n].cfg.seed = 1;
+            n++;
+          }
+        }
+      }
+    }
+  }
+
+  return n;
+}
+
+/* Renders the frames of `c` with the scalar kernels on the calling thread. */
+static int golden_reference(golden_case* c) {
+
+  video_generator_settings cfg = c->cfg;
+  video_generator g;
+  uint8_t* planes[3];
+  uint8_t* buf;
+  uint32_t i, p;
+  int res = 0;
+
+  cfg.simd = VIDEO_GENERATOR_SIMD_NONE;
+  cfg.nthreads = 1;
+  if (0 != (res = video_generator_init(&cfg, &g))) {
+    printf("Error: cannot initialize the generator %d.\n", res);
+    return -1;
+  }
+
+  buf = (uint8_t*)malloc(g.nbytes);
+  if (!buf) {
+    printf("Error: cannot allocate the frame buffer.\n");
+    video_generator_clear(&g);
+    return -2;
+  }
+
+  planes[0] = buf;
+  planes[1] = buf + g.ybytes;
+  planes[2] = buf + g.ybytes + g.ubytes;
+
+  memset(&c->chained, 0x00, sizeof(c->chained));
+  for (i = 0; i < golden_nframes(); ++i) {
+    if (0 != video_generator_render_frame(&g, golden_frame(i), planes)) {
+      res = -3;
+      break;
+    }
+    golden_hash_frame(&g, planes, &c->frames[i]);
+    for (p = 0; p < 3; ++p) {
+      c->chained.plane[p] = xxh64(&c->frames[i].plane[p], sizeof(uint64_t), c->chained.plane[p]);
+    }
+  }
+
+  free(buf);
+  video_generator_clear(&g);
+
+  return res;
+}
+
+/*
+  Renders the frames of `c` with `simd` on `threads` threads through
+  `path` and compares them with the scalar ones. `update` and
+  `update_n` render the GOLDEN_SEQ consecutive frames, `render_frame`
+  jumps to all of them. Returns the number of mismatching frames or -1,
+  `seconds` is set to the time spent rendering.
+*/
+static int golden_check(golden_case* c, uint8_t simd, uint32_t threads, const char* path, double* seconds) {
+
+  video_generator_frame* frames[GOLDEN_BATCH];
+  video_generator_settings cfg = c->cfg;
+  video_generator g;
+  golden_digest d;
+  uint8_t* planes[3];
+  uint8_t* buf = NULL;
+  uint64_t start, total = 0;
+  uint32_t i, k, n;
+  int mismatches = 0;
+
+  cfg.simd = simd;
+  cfg.nthreads = threads;
+  cfg.pool_size = GOLDEN_BATCH;
+  if (0 != video_generator_init(&cfg, &g)) {
+    printf("Error: cannot initialize the generator with simd %s.\n", simd_name(simd));
+    return -1;
+  }
+
+  if (0 == strcmp(path, "update")) {
+    for (i = 0; i < GOLDEN_SEQ; ++i) {
+      start = now_ns();
+      if (0 != video_generator_update(&g)) {
+        mismatches = -1;
+        break;
+      }
+      total += now_ns() - start;
+      planes[0] = g.y;
+      planes[1] = g.u;
+      planes[2] = g.v;
+      golden_hash_frame(&g, planes, &d);
+      mismatches += golden_match(&cfg, simd, threads, path, i, &c->frames[i], &d);
+    }
+  }
+  else if (0 == strcmp(path, "update_n")) {
+    for (i = 0; i < GOLDEN_SEQ; i += GOLDEN_BATCH) {
+      memset(frames, 0x00, sizeof(frames));
+      start = now_ns();
+      if (0 != video_generator_update_n(&g, GOLDEN_BATCH, frames)) {
+        mismatches = -1;
+        break;
+      }
+      total += now_ns() - start;
+      for (k = 0; k < GOLDEN_BATCH; ++k) {
+        planes[0] = frames[k]->y;
+        planes[1] = frames[k]->u;
+        planes[2] = frames[k]->v;
+        golden_hash_frame(&g, planes, &d);
+        mismatches += golden_match(&cfg, simd, threads, path, i + k, &c->frames[i + k], &d);
+        video_generator_release_frame(&g, frames[k]);
+      }
+    }
+  }
+  else {
+    buf = (uint8_t*)malloc(g.nbytes);
+    if (!buf) {
+      printf("Error: cannot allocate the frame buffer.\n");
+      video_generator_clear(&g);
+      return -1;
+    }
+    memset(buf, 0x00, g.nbytes);
+    planes[0] = buf;
+    planes[1] = buf + g.ybytes;
+    planes[2] = buf + g.ybytes + g.ubytes;
+    for (n = golden_nframes(), i = 0; i < n; ++i) {
+      start = now_ns();
+      if (0 != video_generator_render_frame(&g, golden_frame(i), planes)) {
+        mismatches = -1;
+        break;
+      }
+      total += now_ns() - start;
+      golden_hash_frame(&g, planes, &d);
+      mismatches += golden_match(&cfg, simd, threads, path, golden_frame(i), &c->frames[i], &d);
+    }
+    free(buf);
+  }
+
+  if (mismatches < 0) {
+    printf("Error: %s failed with simd %s on %u threads.\n", path, simd_name(simd), threads);
+  }
+
+  video_generator_clear(&g);
+
+  *seconds = (double)total / 1e9;
+
+  return mismatches;
+}
+
+/* Returns 1 and prints the planes that differ when `d` isn't `ref`. */
+static int golden_match(video_generator_settings* s, uint8_t simd, uint32_t threads, const char* path, uint64_t frame, golden_digest* ref, golden_digest* d) {
+
+  char key[128];
+  uint32_t p;
+  int res = 0;
+
+  for (p = 0; p < 3; ++p) {
+    if (ref->plane[p] == d->plane[p]) {
+      continue;
+    }
+    golden_key(s, key, sizeof(key));
+    fprintf(stderr, "Mismatch: %s simd=%s threads=%u %s frame %zu plane %u\n", key, simd_name(simd), threads, path, (size_t)frame, p);
+    res = 1;
+  }
+
+  return res;
+}
+
+/* Compares the chained digests with the golden file, returns the number of cases that don't match or are missing. */
+static int golden_compare_file(golden_case* cases, uint32_t ncases) {
+
+  char line[256];
+  char key[128];
+  char expected[256];
+  uint32_t i;
+  size_t len;
+  int found, mismatches = 0;
+  FILE* fp;
+
+  fp = fopen(golden_file, "r");
+  if (!fp) {
+    printf("Error: cannot open %s, create it with --write-golden.\n", golden_file);
+    return -1;
+  }
+
+  for (i = 0; i < ncases; ++i) {
+
+    golden_key(&cases[i].cfg, key, sizeof(key));
+    snprintf(expected, sizeof(expected), "%s %016llx %016llx %016llx", key,
+             (unsigned long long)cases[i].chained.plane[0], (unsigned long long)cases[i].chained.plane[1],
+             (unsigned long long)cases[i].chained.plane[2]);
+
+    /* the key is the start of the line, the digests follow. */
+    found = 0;
+    rewind(fp);
+    while (0 == found && NULL != fgets(line, sizeof(line), fp)) {
+      len = strlen(key);
+      if (0 == strncmp(line, key, len) && ' ' == line[len]) {
+        line[strcspn(line, "\r\n")] = '\0';
+        found = (0 == strcmp(line, expected)) ? 1 : -1;
+      }
+    }
+
+    if (1 != found) {
+      fprintf(stderr, "Mismatch: %s %s %s\n", key, (0 == found) ? "is missing in" : "differs from", golden_file);
+      mismatches++;
+    }
+  }
+
+  fclose(fp);
+
+  return mismatches;
+}
+
+static int golden_write_file(golden_case* cases, uint32_t ncases) {
+
+  char key[128];
+  uint32_t i;
+  FILE* fp;
+
+  fp = fopen(golden_file, "w");
+  if (!fp) {
+    printf("Error: cannot open %s.\n", golden_file);
+    return -1;
+  }
+
+  fprintf(fp, "# vg_bench --golden: XXH64 of the y, u and v planes of %ux%u frames, chained over %u frames per case.\n",
+          GOLDEN_WIDTH, GOLDEN_HEIGHT, golden_nframes());
+  for (i = 0; i < ncases; ++i) {
+    golden_key(&cases[i].cfg, key, sizeof(key));
+    fprintf(fp, "%s %016llx %016llx %016llx\n", key,
+            (unsigned long long)cases[i].chained.plane[0], (unsigned long long)cases[i].chained.plane[1],
+            (unsigned long long)cases[i].chained.plane[2]);
+  }
+
+  fclose(fp);
+  fprintf(stderr, "Wrote %u cases to %s\n", ncases, golden_file);
+
+  return 0;
+}
+
+static void golden_key(video_generator_settings* s, char* key, size_t nbytes) {
+  snprintf(key, nbytes, "%s-%u-%s-%s%s", format_name(s->format, s->bitdepth), s->bitdepth,
+           (BYTE_ORDER_BIG_ENDIAN == s->byte_order) ? "be" : "le", pattern_name(s->pattern), (1 == s->onecolor) ? "-onecolor" : "");
+}
+
+static uint32_t golden_nframes(void) {
+  return GOLDEN_SEQ + (uint32_t)(sizeof(golden_frames) / sizeof(golden_frames[0]));
+}
+
+/* The frame number of reference frame `i`: first the consecutive ones, then `golden_frames`. */
+static uint64_t golden_frame(uint32_t i) {
+  return (i < GOLDEN_SEQ) ? i : golden_frames[i - GOLDEN_SEQ];
+}
+
+static void golden_hash_frame(video_generator* g, uint8_t* planes[3], golden_digest* d) {
+  d->plane[0] = xxh64(planes[0], g->ybytes, 0);
+  d->plane[1] = (0 == g->ubytes) ? 0 : xxh64(planes[1], g->ubytes, 0);
+  d->plane[2] = (0 == g->vbytes || NULL == planes[2]) ? 0 : xxh64(planes[2], g->vbytes, 0);
+}
+
+static const char* simd_name(uint8_t simd) {
+  switch (simd) {
+    case VIDEO_GENERATOR_SIMD_SSE2: { return "sse2"; }
+    case VIDEO_GENERATOR_SIMD_AVX2: { return "avx2"; }
+    case VIDEO_GENERATOR_SIMD_NEON: { return "neon"; }
+    default:                        { return "none"; }
+  }
+}
+
+/*
+  XXH64, so the digests can be checked with `xxhsum -H64`. The four
+  accumulators are independent, which lets the cpu hash 32 bytes per
+  step. Reads the input as little endian words like the reference on
+  the machines we run on.
+*/
+#define XXH_PRIME1 0x9E3779B185EBCA87ull
+#define XXH_PRIME2 0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME3 0x165667B19E3779F9ull
+#define XXH_PRIME4 0x85EBCA77C2B2AE63ull
+#define XXH_PRIME5 0x27D4EB2F165667C5ull
+#define XXH_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+  acc += input * XXH_PRIME2;
+  acc = XXH_ROTL(acc, 31);
+  return acc * XXH_PRIME1;
+}
+
+static uint64_t xxh64_merge(uint64_t acc, uint64_t val) {
+  acc ^= xxh64_round(0, val);
+  return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+static uint64_t xxh64(const void* data, size_t len, uint64_t seed) {
+
+  const uint8_t* p = (const uint8_t*)data;
+  const uint8_t* end = p + len;
+  uint64_t v1, v2, v3, v4, h, k;
+  uint32_t w;
+
+  if (len >= 32) {
+    v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+    v2 = seed + XXH_PRIME2;
+    v3 = seed;
+    v4 = seed - XXH_PRIME1;
+    do {
+      memcpy(&k, p, 8);      v1 = xxh64_round(v1, k);
+      memcpy(&k, p + 8, 8);  v2 = xxh64_round(v2, k);
+      memcpy(&k, p + 16, 8); v3 = xxh64_round(v3, k);
+      memcpy(&k, p + 24, 8); v4 = xxh64_round(v4, k);
+      p += 32;
+    } while (p + 32 <= end);
+    h = XXH_ROTL(v1, 1) + XXH_ROTL(v2, 7) + XXH_ROTL(v3, 12) + XXH_ROTL(v4, 18);
+    h = xxh64_merge(h, v1);
+    h = xxh64_merge(h, v2);
+    h = xxh64_merge(h, v3);
+    h = xxh64_merge(h, v4);
+  }
+  else {
+    h = seed + XXH_PRIME5;
+  }
+
+  h += (uint64_t)len;
+
+  for (; p + 8 <= end; p += 8) {
+    memcpy(&k, p, 8);
+    h ^= xxh64_round(0, k);
+    h = XXH_ROTL(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+  }
+  if (p + 4 <= end) {
+    memcpy(&w, p, 4);
+    h ^= (uint64_t)w * XXH_PRIME1;
+    h = XXH_ROTL(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= (uint64_t)(*p) * XXH_PRIME5;
+    h = XXH_ROTL(h, 11) * XXH_PRIME1;
+  }
+
+  h ^= h >> 33;
+  h *= XXH_PRIME2;
+  h ^= h >> 29;
+  h *= XXH_PRIME3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+#undef XXH_ROTL
+
+static const char* format_name(uint32_t format, uint32_t bitdepth) {
+  switch (format) {
+    case 400: { return "400"; }
+    case 422: { return "422"; }
+    case 444: { return "444"; }
+    case VIDEO_GENERATOR_FORMAT_NV12: {
+      return (8 == bitdepth) ? "nv12" : (10 == bitdepth) ? "p010" : (12 == bitdepth) ? "p012" : "p016";
+    }
+    default: { return "420"; }
+  }
+}
+
+static const char* pattern_name(uint8_t pattern) {
+  switch (pattern) {
+    case VIDEO_GENERATOR_PATTERN_NOISE:     { return "noise"; }
+    case VIDEO_GENERATOR_PATTERN_GRADIENT:  { return "gradient"; }
+    case VIDEO_GENERATOR_PATTERN_ZONEPLATE: { return "zoneplate"; }
+    default:                                { return "bars"; }
+  }
+}
+
+/* Parses "a,b,c" into `out`, `nv12` is accepted as a format. Returns the number of values. */
+static uint32_t parse_list(const char* str, uint32_t* out) {
+
+  uint32_t n = 0;
+  const char* p = str;
+
+  while (*p && n < MAX_CASES) {
+    if (0 == strncmp(p, "nv12", 4)) {
+      out[n++] = VIDEO_GENERATOR_FORMAT_NV12;
+    }
+    else {
+      out[n++] = (uint32_t)atoi(p);
+    }
+    p = strchr(p, ',');
+    if (!p) {
+      break;
+    }
+    p++;
+  }
+
+  return n;
+}
+
+static int compare_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static uint64_t now_ns(void) {
+#ifdef _WIN32
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER t;
+  if (0 == freq.QuadPart) {
+    QueryPerformanceFrequency(&freq);
+  }
+  QueryPerformanceCounter(&t);
+  return (uint64_t)((double)t.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
@@ -15,20 +15,124 @@
  * permissions and limitations under the License.
  */
 
+#ifndef _WIN32
+#define _GNU_SOURCE /* O_DIRECT, vmsplice() and F_SETPIPE_SZ */
+#endif
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <signal.h>
 #include <video_generator.h>
 #ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
 #include "getopt_long.h"
 #endif
 /* ----------------------------------------------------------------------------------- */
 
 static video_generator_settings cfg;
 static uint32_t max_frames;
+static uint32_t njobs;
+static uint8_t async_write;
+static uint8_t direct_io;
+static uint8_t realtime;
+static int stream_fd = -1;
 static char* filename;
+static char* shm_name;
 #define DEFAULT_FILENAME "output.yuv"
 
+/*
+  The frames can be wrapped so a reader doesn't need to be told the
+  size and format out of band:
+
+  CONTAINER_Y4M     a YUV4MPEG2 stream that ffmpeg and gstreamer read as it is. The
+                    stream header has the size, rate and colorspace (e.g. C420jpeg,
+                    C422p10, Cmono16) and each frame starts with "FRAME\n". Y4M has
+                    no semi-planar or big endian colorspaces.
+  CONTAINER_FRAMED  a FRAMED_STREAM_BYTES stream header followed by frames that each
+                    start with a FRAMED_FRAME_BYTES header, all fields little endian:
+
+                    stream: "VGFS", u32 version (1), u32 width, height, fps, format,
+                            bitdepth, byte_order, u64 bytes per frame.
+                    frame:  "VGFF", u32 header bytes (32), u64 sequence number (0 for the
+                            first frame of the stream), u64 presentation time in ns,
+                            u64 bytes of the frame that follows.
+
+  A frame header is written with its planes in the same writev(),
+  vmsplice() or pwrite(), a frame never straddles two writes of
+  different frames.
+*/
+#define CONTAINER_RAW 0
+#define CONTAINER_Y4M 1
+#define CONTAINER_FRAMED 2
+#define MAX_STREAM_HEADER 64
+#define MAX_FRAME_HEADER 32
+#define FRAMED_STREAM_BYTES 40
+#define FRAMED_FRAME_BYTES 32
+
+static uint8_t container;
+static uint8_t stream_header[MAX_STREAM_HEADER];
+static size_t stream_header_bytes;    /* size of the header in front of the first frame. */
+static size_t frame_header_bytes;     /* size of the header in front of every frame. */
+#define MAX_JOBS 256
+#define WRITER_DEPTH 4                        /* number of frames that can be queued for the writer thread. */
+#define STAGING_SIZE (8 * 1024 * 1024)        /* size of the aligned buffer that is used for O_DIRECT writes. */
+#define STAGING_ALIGN 4096
+#define PIPE_FRAMES 2                         /* number of frames we try to fit in the pipe when streaming. */
+#define MAX_HELD_FRAMES 256                   /* when more frames fit in the pipe we copy them with write(). */
+#define SHM_SLOTS 8                           /* number of frames in the shared memory ring. */
+
+static int container_init(video_generator* gen);
+static size_t frame_header(video_generator* gen, uint64_t seq, uint8_t* dst);
+static void put_le32(uint8_t* dst, uint32_t v);
+static void put_le64(uint8_t* dst, uint64_t v);
+
+#ifndef _WIN32
+/* One contiguous range of frames that is rendered by its own generator. */
+typedef struct shard {
+  thread* handle;
+  int fd;
+  uint32_t first;                 /* first frame number of the range. */
+  uint32_t count;                 /* number of frames in the range. */
+  int result;                     /* 0 on success. */
+} shard;
+
+/* The writer thread that writes the frames which the main thread renders into the frame pool. */
+typedef struct writer {
+  thread* handle;
+  mutex mutex;                    /* protects the members below. */
+  cond cond;                      /* signalled when a frame is queued or written, or when the thread must stop. */
+  video_generator* gen;
+  video_generator_frame* queue[WRITER_DEPTH];
+  uint32_t head;                  /* the next frame to write. */
+  uint32_t count;                 /* number of frames in `queue`. */
+  uint32_t inflight;              /* frames that are queued or being written. */
+  uint8_t must_stop;
+  int result;                     /* 0 on success. */
+  int fd;
+  uint8_t direct;                 /* 1 when the file was opened with O_DIRECT. */
+  uint8_t* staging;               /* O_DIRECT only: aligned buffer that collects frames. */
+  size_t staging_used;
+} writer;
+
+static void* shard_thread(void* user);
+static int write_shards(void);
+static void* writer_thread(void* user);
+static int write_async(video_generator* gen);
+static int write_frame(writer* w, video_generator_frame* f);
+static int write_staging(writer* w, const uint8_t* data, size_t nbytes);
+static int write_all(int fd, const uint8_t* data, size_t nbytes);
+static int write_iov(int fd, struct iovec* iov, int iovcnt, int splice);
+static double seconds_now(void);
+static int open_stream(void);
+static int write_stream(video_generator* gen);
+static int write_shm(video_generator* gen);
+#endif
+
 #ifndef _WIN32
 void usage(char *progname) {
     printf("Usage: %s [options...]\n", progname);
@@ -43,12 +147,27 @@ void usage(char *progname) {
     printf("    -W, --width         width\n");
     printf("    -H, --height        height\n");
     printf("    -n, --max-frames    max frames\n");
-    printf("    -F, --fps           fps\n");
-    printf("    -f, --format        format\n");
+    printf("    -f, --fps           fps\n");
+    printf("    -F, --format        format: 400, 420, 422, 444, nv12, p010 or p016\n");
     printf("    -b, --bitdepth      bitdepth\n");
     printf("    -B, --bigendian     byte order\n");
     printf("    -c, --onecolor      one color background\n");
-    printf("    -o, --output        filename, default " DEFAULT_FILENAME "\n");
+    printf("    -t, --threads       number of render threads\n");
+    printf("    -j, --jobs          render N contiguous ranges of frames in parallel\n");
+    printf("    -a, --async         write the frames from a separate thread\n");
+    printf("    -D, --direct        write with O_DIRECT, implies --async\n");
+    printf("    -o, --output        filename, default " DEFAULT_FILENAME ", - or a fifo streams the frames\n");
+    printf("    -r, --realtime      when streaming or publishing, deliver the frames at fps\n");
+    printf("    -T, --no-timestamp  don't draw the text box with the time stamp\n");
+    printf("    -C, --cycle-cache   render the repeating frames once (needs -c 1 or -T)\n");
+    printf("    -I, --frame-id      draw the frame number and render time as a block code\n");
+    printf("    -P, --pattern       bars (default), noise, gradient or zoneplate\n");
+    printf("        --seed          seed of the noise pattern\n");
+    printf("    -L, --hugepages     back the frame buffers with huge pages\n");
+    printf("    -N, --numa          allocate the frames and run the render threads on this numa node\n");
+    printf("    -p, --prefault      touch all frame buffers at init\n");
+    printf("    -S, --shm           publish the frames in this shared memory ring (e.g. /videogen) instead of a file\n");
+    printf("    -M, --container     raw (default), y4m or framed: headers with the size, format and frame timestamps\n");
 }
 
 int parse_options(int argc, char **argv) {
@@ -66,12 +185,27 @@ int parse_options(int argc, char **argv) {
         {"bitdepth",  required_argument,  NULL, 'b'},
         {"big-endian",required_argument,  NULL, 'B'},
         {"onecolor",  required_argument,  NULL, 'c'},
+        {"threads",   required_argument,  NULL, 't'},
+        {"jobs",      required_argument,  NULL, 'j'},
+        {"async",     no_argument,        NULL, 'a'},
+        {"direct",    no_argument,        NULL, 'D'},
+        {"realtime",  no_argument,        NULL, 'r'},
+        {"no-timestamp", no_argument,     NULL, 'T'},
+        {"cycle-cache", no_argument,      NULL, 'C'},
+        {"frame-id",  no_argument,        NULL, 'I'},
+        {"shm",       required_argument,  NULL, 'S'},
+        {"pattern",   required_argument,  NULL, 'P'},
+        {"seed",      required_argument,  NULL, 's'},
+        {"hugepages", no_argument,        NULL, 'L'},
+        {"numa",      required_argument,  NULL, 'N'},
+        {"prefault",  no_argument,        NULL, 'p'},
+        {"container", required_argument,  NULL, 'M'},
         {NULL,        0,                  NULL,   0}
     };
 
     int opt;
     while ((opt = getopt_long(argc, argv,
-                              "+hW:H:n:f:F:b:o:Bc:",
+                              "+hW:H:n:f:F:b:o:Bc:t:j:aDrTCIS:P:s:LN:pM:",
                               long_options, NULL)) > 0) {
         switch (opt) {
             default:
@@ -90,7 +224,21 @@ int parse_options(int argc, char **argv) {
                 cfg.fps = (uint32_t)atoi(optarg);
                 break;
             case 'F':
-                cfg.format = (uint32_t)atoi(optarg);
+                if (0 == strcmp(optarg, "nv12")) {
+                    cfg.format = VIDEO_GENERATOR_FORMAT_NV12;
+                    cfg.bitdepth = 8;
+                }
+                else if (0 == strcmp(optarg, "p010")) {
+                    cfg.format = VIDEO_GENERATOR_FORMAT_NV12;
+                    cfg.bitdepth = 10;
+                }
+                else if (0 == strcmp(optarg, "p016")) {
+                    cfg.format = VIDEO_GENERATOR_FORMAT_NV12;
+                    cfg.bitdepth = 16;
+                }
+                else {
+                    cfg.format = (uint32_t)atoi(optarg);
+                }
                 break;
             case 'b':
                 cfg.bitdepth = (uint8_t)atoi(optarg);
@@ -104,6 +252,81 @@ int parse_options(int argc, char **argv) {
             case 'c':
                 cfg.onecolor = (uint8_t)atoi(optarg);
                 break;
+            case 't':
+                cfg.nthreads = (uint32_t)atoi(optarg);
+                break;
+            case 'j':
+                njobs = (uint32_t)atoi(optarg);
+                break;
+            case 'a':
+                async_write = 1;
+                break;
+            case 'D':
+                async_write = 1;
+                direct_io = 1;
+                break;
+            case 'r':
+                realtime = 1;
+                break;
+            case 'T':
+                cfg.no_timestamp = 1;
+                break;
+            case 'C':
+                cfg.cycle_cache = 1;
+                break;
+            case 'I':
+                cfg.frame_id = 1;
+                break;
+            case 'P':
+                if (0 == strcmp(optarg, "noise")) {
+                    cfg.pattern = VIDEO_GENERATOR_PATTERN_NOISE;
+                }
+                else if (0 == strcmp(optarg, "gradient")) {
+                    cfg.pattern = VIDEO_GENERATOR_PATTERN_GRADIENT;
+                }
+                else if (0 == strcmp(optarg, "zoneplate")) {
+                    cfg.pattern = VIDEO_GENERATOR_PATTERN_ZONEPLATE;
+                }
+                else if (0 == strcmp(optarg, "bars")) {
+                    cfg.pattern = VIDEO_GENERATOR_PATTERN_BARS;
+                }
+                else {
+                    usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 's':
+                cfg.seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'L':
+                cfg.alloc_flags |= VIDEO_GENERATOR_ALLOC_HUGEPAGES;
+                break;
+            case 'N':
+                cfg.alloc_flags |= VIDEO_GENERATOR_ALLOC_NUMA;
+                cfg.numa_node = (uint32_t)atoi(optarg);
+                break;
+            case 'p':
+                cfg.alloc_flags |= VIDEO_GENERATOR_ALLOC_PREFAULT;
+                break;
+            case 'M':
+                if (0 == strcmp(optarg, "y4m")) {
+                    container = CONTAINER_Y4M;
+                }
+                else if (0 == strcmp(optarg, "framed")) {
+                    container = CONTAINER_FRAMED;
+                }
+                else if (0 == strcmp(optarg, "raw")) {
+                    container = CONTAINER_RAW;
+                }
+                else {
+                    usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 'S':
+                free(shm_name);
+                shm_name = strdup(optarg);
+                break;
             case 'o':
                 free(filename);
                 filename = (char*)malloc(strlen(optarg) + 1);
@@ -113,7 +336,652 @@ int parse_options(int argc, char **argv) {
     }
     return optind;
 }
+
+/*
+  Splits the frames into `njobs` contiguous ranges, each rendered by a
+  thread with its own generator using random access rendering. Every
+  frame is written at its final offset so the file is identical to the
+  one that is written frame by frame; the frame headers have a fixed
+  size so the offsets are known up front.
+*/
+static int write_shards(void) {
+
+  shard shards[MAX_JOBS];
+  uint32_t i;
+  int fd, result = 0;
+
+  fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    printf("Error: cannot open %s.\n", filename);
+    return -1;
+  }
+
+  if (0 != write_all(fd, stream_header, stream_header_bytes)) {
+    close(fd);
+    return -2;
+  }
+
+  for (i = 0; i < njobs; ++i) {
+    shards[i].fd = fd;
+    shards[i].first = (uint32_t)(((uint64_t)max_frames * i) / njobs);
+    shards[i].count = (uint32_t)(((uint64_t)max_frames * (i + 1)) / njobs) - shards[i].first;
+    shards[i].result = 0;
+    shards[i].handle = thread_alloc(shard_thread, &shards[i]);
+    if (NULL == shards[i].handle) {
+      printf("Error: cannot create job %u.\n", i);
+      shard_thread(&shards[i]);
+    }
+  }
+
+  for (i = 0; i < njobs; ++i) {
+    if (NULL != shards[i].handle) {
+      thread_join(shards[i].handle);
+      thread_free(shards[i].handle);
+    }
+    if (0 != shards[i].result) {
+      result = shards[i].result;
+    }
+  }
+
+  close(fd);
+
+  return result;
+}
+
+static void* shard_thread(void* user) {
+
+  shard* s = (shard*)user;
+  video_generator_settings shard_cfg = cfg;
+  video_generator g;
+  uint8_t* planes[3];
+  uint8_t* buf;
+  uint8_t* pixels;
+  uint32_t i;
+  size_t done, nbytes;
+  ssize_t r;
+  off_t offset;
+
+  /* the frames of a range are rendered on this thread only. */
+  shard_cfg.nthreads = 0;
+  if (0 != video_generator_init(&shard_cfg, &g)) {
+    s->result = -1;
+    return NULL;
+  }
+
+  /* the frame header is rendered in front of the planes so a frame is one pwrite(). */
+  nbytes = frame_header_bytes + g.nbytes;
+  buf = (uint8_t*)malloc(nbytes);
+  if (NULL == buf) {
+    video_generator_clear(&g);
+    s->result = -2;
+    return NULL;
+  }
+
+  pixels = buf + frame_header_bytes;
+  planes[0] = pixels;
+  planes[1] = pixels + g.ybytes;
+  planes[2] = pixels + g.ybytes + g.ubytes;
+
+  for (i = s->first; i < s->first + s->count && 0 == s->result; ++i) {
+
+    if (0 != video_generator_render_frame(&g, i, planes)) {
+      s->result = -3;
+      break;
+    }
+
+    frame_header(&g, i, buf);
+    offset = (off_t)stream_header_bytes + (off_t)i * (off_t)nbytes;
+    for (done = 0; done < nbytes; done += (size_t)r) {
+      r = pwrite(s->fd, buf + done, nbytes - done, offset + (off_t)done);
+      if (r <= 0) {
+        printf("Error: failed to write frame %u.\n", i);
+        s->result = -4;
+        break;
+      }
+    }
+  }
+
+  free(buf);
+  video_generator_clear(&g);
+
+  return NULL;
+}
+
+/*
+  Renders into the frame pool on the calling thread while the writer
+  thread writes the previous frames, so rendering and disk I/O overlap.
+*/
+static int write_async(video_generator* gen) {
+
+  writer w;
+  video_generator_frame* f = NULL;
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  int result;
+
+  memset(&w, 0x00, sizeof(w));
+  w.gen = gen;
+
+#ifdef O_DIRECT
+  if (direct_io) {
+    w.fd = open(filename, flags | O_DIRECT, 0644);
+    if (w.fd >= 0) {
+      w.direct = 1;
+    }
+    else {
+      printf("Warning: cannot open %s with O_DIRECT, using buffered writes.\n", filename);
+    }
+  }
+#else
+  if (direct_io) {
+    printf("Warning: O_DIRECT is not supported on this platform, using buffered writes.\n");
+  }
+#endif
+
+  if (0 == w.direct) {
+    w.fd = open(filename, flags, 0644);
+  }
+  if (w.fd < 0) {
+    printf("Error: cannot open %s.\n", filename);
+    return -1;
+  }
+
+  if (w.direct && 0 != posix_memalign((void**)&w.staging, STAGING_ALIGN, STAGING_SIZE)) {
+    printf("Error: cannot allocate the staging buffer.\n");
+    close(w.fd);
+    return -2;
+  }
+
+  /* with O_DIRECT the stream header goes through the staging buffer too. */
+  result = (w.direct) ? write_staging(&w, stream_header, stream_header_bytes) : write_all(w.fd, stream_header, stream_header_bytes);
+  if (0 != result) {
+    free(w.staging);
+    close(w.fd);
+    return result;
+  }
+
+  mutex_init(&w.mutex);
+  cond_init(&w.cond);
+
+  w.handle = thread_alloc(writer_thread, &w);
+  if (NULL == w.handle) {
+    printf("Error: cannot create the writer thread.\n");
+    w.result = -3;
+  }
+
+  while (gen->frame < max_frames && NULL != w.handle) {
+
+    /* wait for a free buffer; the pool has one buffer for each frame that can be in flight. */
+    mutex_lock(&w.mutex);
+    while (WRITER_DEPTH == w.inflight && 0 == w.result) {
+      cond_wait(&w.cond, &w.mutex);
+    }
+    result = w.result;
+    mutex_unlock(&w.mutex);
+
+    if (0 != result) {
+      break;
+    }
+
+    if (0 != video_generator_acquire_frame(gen, &f)) {
+      printf("Error: cannot acquire a frame.\n");
+      break;
+    }
+
+    mutex_lock(&w.mutex);
+    w.queue[(w.head + w.count) % WRITER_DEPTH] = f;
+    w.count++;
+    w.inflight++;
+    cond_broadcast(&w.cond);
+    mutex_unlock(&w.mutex);
+  }
+
+  if (NULL != w.handle) {
+    mutex_lock(&w.mutex);
+    w.must_stop = 1;
+    cond_broadcast(&w.cond);
+    mutex_unlock(&w.mutex);
+    thread_join(w.handle);
+    thread_free(w.handle);
+  }
+
+  cond_destroy(&w.cond);
+  mutex_destroy(&w.mutex);
+  free(w.staging);
+  close(w.fd);
+
+  return w.result;
+}
+
+static void* writer_thread(void* user) {
+
+  writer* w = (writer*)user;
+  video_generator_frame* f;
+  size_t aligned;
+  int r = 0;
+
+  mutex_lock(&w->mutex);
+  while (1) {
+
+    while (0 == w->count && 0 == w->must_stop) {
+      cond_wait(&w->cond, &w->mutex);
+    }
+    if (0 == w->count) {
+      break;
+    }
+
+    f = w->queue[w->head];
+    w->head = (w->head + 1) % WRITER_DEPTH;
+    w->count--;
+    mutex_unlock(&w->mutex);
+
+    if (0 == r) {
+      r = write_frame(w, f);
+    }
+    video_generator_release_frame(w->gen, f);
+
+    mutex_lock(&w->mutex);
+    w->inflight--;
+    w->result = r;
+    cond_broadcast(&w->cond);
+  }
+  mutex_unlock(&w->mutex);
+
+  /* O_DIRECT only writes whole blocks, the last partial block is written without it. */
+  if (0 == r && w->direct && 0 != w->staging_used) {
+    aligned = w->staging_used & ~(size_t)(STAGING_ALIGN - 1);
+    r = write_all(w->fd, w->staging, aligned);
+    if (0 == r && aligned != w->staging_used) {
+      fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) & ~O_DIRECT);
+      r = write_all(w->fd, w->staging + aligned, w->staging_used - aligned);
+    }
+  }
+
+  mutex_lock(&w->mutex);
+  w->result = r;
+  mutex_unlock(&w->mutex);
+
+  return NULL;
+}
+
+/* Writes the header and the y, u and v planes of one frame with one writev() or, with O_DIRECT, via the staging buffer. */
+static int write_frame(writer* w, video_generator_frame* f) {
+
+  uint8_t header[MAX_FRAME_HEADER];
+  struct iovec iov[4];
+  size_t nheader;
+
+  nheader = frame_header(w->gen, f->frame, header);
+
+  if (w->direct) {
+    if (0 != write_staging(w, header, nheader)) {
+      return -4;
+    }
+    return write_staging(w, f->y, w->gen->nbytes);
+  }
+
+  iov[0].iov_base = header;
+  iov[0].iov_len = nheader;
+  iov[1].iov_base = f->y;
+  iov[1].iov_len = w->gen->ybytes;
+  iov[2].iov_base = f->u;
+  iov[2].iov_len = w->gen->ubytes;
+  iov[3].iov_base = f->v;
+  iov[3].iov_len = w->gen->vbytes;
+
+  if (0 != write_iov(w->fd, iov, 4, 0)) {
+    printf("Error: failed to write frame %zu.\n", (size_t)f->frame);
+    return -5;
+  }
+
+  return 0;
+}
+
+/* Appends to the O_DIRECT staging buffer and writes it whenever it's full. */
+static int write_staging(writer* w, const uint8_t* data, size_t nbytes) {
+
+  size_t n;
+
+  while (0 != nbytes) {
+    n = STAGING_SIZE - w->staging_used;
+    n = (n < nbytes) ? n : nbytes;
+    memcpy(w->staging + w->staging_used, data, n);
+    w->staging_used += n;
+    data += n;
+    nbytes -= n;
+    if (STAGING_SIZE == w->staging_used) {
+      if (0 != write_all(w->fd, w->staging, STAGING_SIZE)) {
+        return -4;
+      }
+      w->staging_used = 0;
+    }
+  }
+
+  return 0;
+}
+
+/*
+  Writes all `iov` with writev(), or vmsplice() when `splice` is set,
+  and continues where a short write stopped. Changes `iov`.
+*/
+static int write_iov(int fd, struct iovec* iov, int iovcnt, int splice) {
+
+  ssize_t r;
+  size_t n;
+  int i = 0;
+
+  while (i < iovcnt) {
+#if defined(__linux__)
+    r = (splice) ? vmsplice(fd, iov + i, (unsigned long)(iovcnt - i), 0) : writev(fd, iov + i, iovcnt - i);
+#else
+    (void)splice;
+    r = writev(fd, iov + i, iovcnt - i);
+#endif
+    if (r <= 0) {
+      return -1;
+    }
+    for (n = (size_t)r; i < iovcnt && n >= iov[i].iov_len; ++i) {
+      n -= iov[i].iov_len;
+    }
+    if (i < iovcnt) {
+      iov[i].iov_base = (uint8_t*)iov[i].iov_base + n;
+      iov[i].iov_len -= n;
+    }
+  }
+
+  return 0;
+}
+
+static int write_all(int fd, const uint8_t* data, size_t nbytes) {
+  ssize_t r;
+  while (0 != nbytes) {
+    r = write(fd, data, nbytes);
+    if (r <= 0) {
+      printf("Error: failed to write to %s.\n", filename);
+      return -6;
+    }
+    data += r;
+    nbytes -= (size_t)r;
+  }
+  return 0;
+}
+
+/*
+  Opens the output when it's `-` (stdout) or a fifo. Because the frames
+  go to stdout, everything we print goes to stderr from now on.
+  Returns 1 when we stream, 0 when the output is a regular file.
+*/
+static int open_stream(void) {
+
+  struct stat st;
+
+  if (0 == strcmp(filename, "-")) {
+    fflush(stdout);
+    stream_fd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+  }
+  else if (0 == stat(filename, &st) && S_ISFIFO(st.st_mode)) {
+    stream_fd = open(filename, O_WRONLY);
+  }
+  else {
+    return 0;
+  }
+
+  if (stream_fd < 0) {
+    printf("Error: cannot open %s.\n", filename);
+    exit(1);
+  }
+
+  /* a reader that goes away ends the stream. */
+  signal(SIGPIPE, SIG_IGN);
+
+  return 1;
+}
+
+/*
+  Streams the frames to a pipe. On Linux we grow the pipe so it holds
+  PIPE_FRAMES frames and vmsplice() the (page aligned) pool buffers into
+  it, which hands the pages to the pipe without copying them. The pipe
+  keeps referencing those pages until the reader consumed them, so a
+  buffer is only reused after enough frames were spliced after it to
+  fill the complete pipe.
+*/
+static int write_stream(video_generator* gen) {
+
+  static uint8_t headers[MAX_HELD_FRAMES][MAX_FRAME_HEADER]; /* the pipe references the header of a held frame too. */
+  video_generator_frame* held[MAX_HELD_FRAMES];
+  video_generator_frame* f = NULL;
+  video_generator_pacing pacing;
+  struct stat st;
+  uint32_t nheld = 0, oldest = 0, max_held = 0, slot;
+  uint64_t nbytes = gen->nbytes;
+  int use_splice = 0;
+  int pipe_size = 0;
+  int result = 0;
+  double start;
+  struct iovec iov[2];
+#if defined(__linux__)
+  FILE* fp = NULL;
+  int max_size = 0;
+#endif
+
+  if (0 == fstat(stream_fd, &st) && S_ISFIFO(st.st_mode)) {
+#if defined(__linux__)
+    pipe_size = (int)((nbytes * PIPE_FRAMES < INT_MAX) ? nbytes * PIPE_FRAMES : INT_MAX);
+    if (0 > fcntl(stream_fd, F_SETPIPE_SZ, pipe_size)) {
+      /* unprivileged processes can't go beyond pipe-max-size. */
+      fp = fopen("/proc/sys/fs/pipe-max-size", "r");
+      if (NULL != fp && 1 == fscanf(fp, "%d", &max_size) && max_size < pipe_size) {
+        fcntl(stream_fd, F_SETPIPE_SZ, max_size);
+      }
+      if (NULL != fp) {
+        fclose(fp);
+      }
+    }
+    pipe_size = fcntl(stream_fd, F_GETPIPE_SZ);
+    use_splice = (pipe_size > 0) ? 1 : 0;
 #endif
+    printf("Pipe buffer: %d bytes, %.2f frames\n", pipe_size, (double)pipe_size / (double)nbytes);
+  }
+
+  /* the pool needs a buffer for each frame that may still be in the pipe. */
+  max_held = use_splice ? (uint32_t)((uint64_t)pipe_size / nbytes) + 2 : 0;
+  if (max_held >= MAX_HELD_FRAMES) {
+    max_held = 0;
+    use_splice = 0;
+  }
+
+  video_generator_clear(gen);
+  cfg.pool_size = max_held + 1;
+  if (0 != video_generator_init(&cfg, gen)) {
+    printf("Error: cannot initialize the generator with a frame pool.\n");
+    return -1;
+  }
+
+  start = seconds_now();
+
+  result = write_all(stream_fd, stream_header, stream_header_bytes);
+
+  while (gen->frame < max_frames && 0 == result) {
+
+    if (realtime) {
+      video_generator_wait_next_frame(gen);
+    }
+
+    if (0 != video_generator_acquire_frame(gen, &f)) {
+      printf("Error: cannot acquire a frame.\n");
+      result = -2;
+      break;
+    }
+
+    /* the header and the frame go into the pipe together. */
+    slot = (oldest + nheld) % MAX_HELD_FRAMES;
+    iov[0].iov_base = headers[slot];
+    iov[0].iov_len = frame_header(gen, f->frame, headers[slot]);
+    iov[1].iov_base = f->y;
+    iov[1].iov_len = gen->nbytes;
+    if (0 != write_iov(stream_fd, iov, 2, use_splice)) {
+      printf("Error: failed to %s frame %zu.\n", (use_splice) ? "splice" : "write", (size_t)f->frame);
+      result = -3;
+    }
+
+    /* release the oldest frame once the pipe can't reference it anymore. */
+    held[slot] = f;
+    nheld++;
+    if (nheld > max_held) {
+      video_generator_release_frame(gen, held[oldest]);
+      oldest = (oldest + 1) % MAX_HELD_FRAMES;
+      nheld--;
+    }
+  }
+
+  while (0 != nheld) {
+    video_generator_release_frame(gen, held[oldest]);
+    oldest = (oldest + 1) % MAX_HELD_FRAMES;
+    nheld--;
+  }
+
+  printf("Frames streamed: %zu\n", (size_t)gen->frame);
+  printf("Throughput: %.1f MB/s\n", ((double)gen->frame * (double)gen->nbytes) / (1024.0 * 1024.0) / (seconds_now() - start));
+  if (realtime && 0 == video_generator_get_pacing(gen, &pacing) && 0 != pacing.frames) {
+    printf("Late frames: %zu of %zu, at most %.3f ms late, wake up jitter at most %.1f us\n",
+           (size_t)pacing.late, (size_t)pacing.frames, (double)pacing.late_max_ns / 1e6, (double)pacing.jitter_max_ns / 1e3);
+  }
+
+  close(stream_fd);
+
+  return result;
+}
+
+/*
+  Renders the frames straight into the slots of a shared memory ring.
+  The readers map the ring themselves, see "Shared memory ring" in
+  video_generator.h; nothing is copied and nobody is waited for.
+*/
+static int write_shm(video_generator* gen) {
+
+  video_generator_shm shm;
+  video_generator_pacing pacing;
+  double start;
+  int result = 0;
+
+  if (0 != video_generator_shm_create(gen, shm_name, SHM_SLOTS, &shm)) {
+    return -1;
+  }
+
+  printf("Publishing in %s, %u slots of %zu bytes\n", shm_name, SHM_SLOTS, (size_t)shm.header->slot_bytes);
+
+  start = seconds_now();
+
+  while (gen->frame < max_frames && 0 == result) {
+    if (realtime) {
+      video_generator_wait_next_frame(gen);
+    }
+    result = video_generator_shm_update(gen, &shm);
+  }
+
+  printf("Frames published: %zu\n", (size_t)gen->frame);
+  printf("Throughput: %.1f MB/s\n", ((double)gen->frame * (double)gen->nbytes) / (1024.0 * 1024.0) / (seconds_now() - start));
+  if (realtime && 0 == video_generator_get_pacing(gen, &pacing) && 0 != pacing.frames) {
+    printf("Late frames: %zu of %zu, at most %.3f ms late, wake up jitter at most %.1f us\n",
+           (size_t)pacing.late, (size_t)pacing.frames, (double)pacing.late_max_ns / 1e6, (double)pacing.jitter_max_ns / 1e3);
+  }
+
+  video_generator_shm_close(&shm);
+
+  return result;
+}
+
+static double seconds_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+#endif
+
+/* Creates the stream header of `container`, returns -1 when the container can't hold the frames. */
+static int container_init(video_generator* gen) {
+
+  char depth[8] = "";
+  const char* cs;
+  uint8_t* h = stream_header;
+  int n;
+
+  stream_header_bytes = 0;
+  frame_header_bytes = 0;
+
+  if (CONTAINER_Y4M == container) {
+
+    if (VIDEO_GENERATOR_FORMAT_NV12 == gen->format || BYTE_ORDER_BIG_ENDIAN == gen->byte_order) {
+      printf("Error: y4m only holds planar little endian frames.\n");
+      return -1;
+    }
+
+    switch (gen->format) {
+      case 400: { cs = "mono"; break; }
+      case 422: { cs = "422";  break; }
+      case 444: { cs = "444";  break; }
+      default:  { cs = (8 == gen->bitdepth) ? "420jpeg" : "420"; break; }
+    }
+    if (8 != gen->bitdepth) {
+      snprintf(depth, sizeof(depth), "%s%u", (400 == gen->format) ? "" : "p", gen->bitdepth);
+    }
+
+    n = snprintf((char*)stream_header, sizeof(stream_header), "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C%s%s\n",
+                 gen->width, gen->height, gen->fps_den, cs, depth);
+    if (n <= 0 || (size_t)n >= sizeof(stream_header)) {
+      return -1;
+    }
+
+    stream_header_bytes = (size_t)n;
+    frame_header_bytes = 6;
+  }
+  else if (CONTAINER_FRAMED == container) {
+
+    memcpy(h, "VGFS", 4);
+    put_le32(h + 4, 1);
+    put_le32(h + 8, gen->width);
+    put_le32(h + 12, gen->height);
+    put_le32(h + 16, gen->fps_den);
+    put_le32(h + 20, gen->format);
+    put_le32(h + 24, gen->bitdepth);
+    put_le32(h + 28, gen->byte_order);
+    put_le64(h + 32, gen->nbytes);
+
+    stream_header_bytes = FRAMED_STREAM_BYTES;
+    frame_header_bytes = FRAMED_FRAME_BYTES;
+  }
+
+  return 0;
+}
+
+/* Writes the header of frame `seq` into `dst`, returns its size (0 for raw frames). */
+static size_t frame_header(video_generator* gen, uint64_t seq, uint8_t* dst) {
+
+  if (CONTAINER_Y4M == container) {
+    memcpy(dst, "FRAME\n", 6);
+  }
+  else if (CONTAINER_FRAMED == container) {
+    memcpy(dst, "VGFF", 4);
+    put_le32(dst + 4, FRAMED_FRAME_BYTES);
+    put_le64(dst + 8, seq);
+    put_le64(dst + 16, (0 == gen->fps_den) ? 0 : (seq * 1000000000ull) / gen->fps_den);
+    put_le64(dst + 24, gen->nbytes);
+  }
+
+  return frame_header_bytes;
+}
+
+static void put_le32(uint8_t* dst, uint32_t v) {
+  dst[0] = (uint8_t)v;
+  dst[1] = (uint8_t)(v >> 8);
+  dst[2] = (uint8_t)(v >> 16);
+  dst[3] = (uint8_t)(v >> 24);
+}
+
+static void put_le64(uint8_t* dst, uint64_t v) {
+  put_le32(dst, (uint32_t)v);
+  put_le32(dst + 4, (uint32_t)(v >> 32));
+}
 
 int main(int argc, char* argv[]) {
 
@@ -123,8 +991,10 @@ int main(int argc, char* argv[]) {
   int res;
 
   video_generator gen;
-
-  video_fp = fopen("output.yuv", "wb");
+#ifndef _WIN32
+  double start;
+  int is_stream = 0;
+#endif
 
   cfg.width = 720;
   cfg.height = 480;
@@ -134,6 +1004,10 @@ int main(int argc, char* argv[]) {
 
 #ifndef _WIN32
   parse_options(argc, argv);
+  if (async_write) {
+    cfg.pool_size = WRITER_DEPTH;
+  }
+  is_stream = open_stream();
 #endif
 
   if ((res = video_generator_init(&cfg, &gen))) {
@@ -141,6 +1015,11 @@ int main(int argc, char* argv[]) {
     exit(1);
   }
 
+  if (0 != container_init(&gen)) {
+    video_generator_clear(&gen);
+    exit(1);
+  }
+
   printf("Create a YUV file: %s \nwidth: %d\nheight: %d \nfps: %d\nframes: %d\nformat: %d\nbitdepth: %d\nbigendian:%d\n",
             filename,
             cfg.width,
@@ -151,18 +1030,85 @@ int main(int argc, char* argv[]) {
             cfg.bitdepth,
             cfg.byte_order);
 
+#ifndef _WIN32
+  start = seconds_now();
+
+  if (NULL != shm_name) {
+    if (CONTAINER_RAW != container) {
+      printf("Warning: the shared memory ring describes the frames itself, --container is ignored.\n");
+    }
+    res = write_shm(&gen);
+    free(shm_name);
+    free(filename);
+    video_generator_clear(&gen);
+    return (0 == res) ? 0 : 1;
+  }
+
+  if (is_stream) {
+    res = write_stream(&gen);
+    free(filename);
+    video_generator_clear(&gen);
+    return (0 == res) ? 0 : 1;
+  }
+
+  if (async_write && njobs <= 1) {
+    res = write_async(&gen);
+    printf("Frames generated: %zu\n", (size_t)gen.frame);
+    printf("Throughput: %.1f MB/s\n", ((double)gen.frame * (double)gen.nbytes) / (1024.0 * 1024.0) / (seconds_now() - start));
+    free(filename);
+    video_generator_clear(&gen);
+    return (0 == res) ? 0 : 1;
+  }
+
+  if (njobs > 1) {
+    njobs = (njobs > MAX_JOBS) ? MAX_JOBS : njobs;
+    res = write_shards();
+    printf("Frames generated: %u with %u jobs\n", (0 == res) ? max_frames : 0, njobs);
+    printf("Throughput: %.1f MB/s\n", ((double)max_frames * (double)gen.nbytes) / (1024.0 * 1024.0) / (seconds_now() - start));
+    free(filename);
+    video_generator_clear(&gen);
+    return (0 == res) ? 0 : 1;
+  }
+#endif
+
+  video_fp = fopen(filename, "wb");
+  if (NULL == video_fp) {
+    printf("Error: cannot open %s.\n", filename);
+    exit(1);
+  }
+
+  fwrite((const char*)stream_header, stream_header_bytes, 1, video_fp);
+
   while (gen.frame < max_frames) {
+
+    // the headers go through the same stdio buffer as the planes.
+    uint8_t header[MAX_FRAME_HEADER];
+    fwrite((const char*)header, frame_header(&gen, gen.frame, header), 1, video_fp);
+
+    // the cached frames can be written as they are, without a copy.
+    if (NULL != gen.cycle) {
+      const uint8_t* frame = NULL;
+      video_generator_next_cached(&gen, &frame);
+      fwrite((const char*)frame, gen.nbytes, 1, video_fp);
+      continue;
+    }
+
     video_generator_update(&gen);
 
     // write video planes to a file
     fwrite((char*)gen.y, gen.ybytes, 1,  video_fp);
     fwrite((char*)gen.u, gen.ubytes, 1, video_fp);
-    fwrite((char*)gen.v, gen.vbytes, 1, video_fp);
+    if (0 != gen.vbytes) {
+      fwrite((char*)gen.v, gen.vbytes, 1, video_fp);
+    }
 
   }
   printf("Frames generated: %zu\n", (size_t)gen.frame);
 
 fclose(video_fp);
+#ifndef _WIN32
+  printf("Throughput: %.1f MB/s\n", ((double)gen.frame * (double)gen.nbytes) / (1024.0 * 1024.0) / (seconds_now() - start));
+#endif
 free(filename);
 video_generator_clear(&gen);
 }
@@ -15,11 +15,20 @@
  * permissions and limitations under the License.
  */
 
+/* for pthread_setaffinity_np() and the cpu_set_t macros, see `workers_bind()`. */
+#if defined(__linux) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <math.h>
 #include <video_generator.h>
+#if defined(_WIN32)
+#  include <malloc.h>
+#endif
 
 /* ----------------------------------------------------------------------------------- */
 /*                          T H R E A D I N G                                          */
@@ -60,30 +69,83 @@
     return 0;
   }
 
+  int thread_free(thread* t) {
+    if (NULL == t) { return -1; }
+    if (0 == CloseHandle(t->handle)) { free(t); return -2; }
+    free(t);
+    return 0;
+  }
+
+  /* A critical section so it can be used together with condition variables. */
   int mutex_init(mutex* m) {
     if (NULL == m) { return -1; }
-    m->handle = CreateMutex(NULL, FALSE, NULL); /* default security, not owned by calling thread, unnamed. */
-    if (NULL == m->handle) { return -2; }
+    InitializeCriticalSection(&m->handle);
     return 0;
   }
 
   int mutex_destroy(mutex* m) {
     if (NULL == m) { return -1; }
-    if (0 == CloseHandle(m->handle)) { return -2; }
+    DeleteCriticalSection(&m->handle);
     return 0;
   }
 
   int mutex_lock(mutex* m) {
     if (NULL == m) { return -1; }
-    DWORD r = WaitForSingleObject(m->handle, INFINITE);
-    if (WAIT_OBJECT_0 == r) { return 0 ; }
-    else if (WAIT_ABANDONED == r) { return -2; }
+    EnterCriticalSection(&m->handle);
     return 0;
   }
 
   int mutex_unlock(mutex* m) {
     if (NULL == m) { return -1; }
-    if (!ReleaseMutex(m->handle)) { return -2; }
+    LeaveCriticalSection(&m->handle);
+    return 0;
+  }
+
+  int cond_init(cond* c) {
+    if (NULL == c) { return -1; }
+    InitializeConditionVariable(&c->handle);
+    return 0;
+  }
+
+  int cond_destroy(cond* c) {
+    if (NULL == c) { return -1; }
+    return 0;
+  }
+
+  int cond_wait(cond* c, mutex* m) {
+    if (NULL == c) { return -1; }
+    if (NULL == m) { return -2; }
+    if (!SleepConditionVariableCS(&c->handle, &m->handle, INFINITE)) { return -3; }
+    return 0;
+  }
+
+  int cond_signal(cond* c) {
+    if (NULL == c) { return -1; }
+    WakeConditionVariable(&c->handle);
+    return 0;
+  }
+
+  int cond_broadcast(cond* c) {
+    if (NULL == c) { return -1; }
+    WakeAllConditionVariable(&c->handle);
+    return 0;
+  }
+
+  /* MMCSS is loaded at runtime so we don't have to link with avrt.lib. */
+  int thread_set_realtime(void) {
+    typedef HANDLE(WINAPI* mmcss_func)(LPCSTR task, LPDWORD index);
+    HMODULE avrt = LoadLibraryA("avrt.dll");
+    mmcss_func set_task = NULL;
+    DWORD index = 0;
+    if (NULL != avrt) {
+      set_task = (mmcss_func)GetProcAddress(avrt, "AvSetMmThreadCharacteristicsA");
+    }
+    if (NULL != set_task && NULL != set_task("Pro Audio", &index)) {
+      return 0;
+    }
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+      return -1;
+    }
     return 0;
   }
 
@@ -143,6 +205,55 @@
     return 0;
   }
 
+  int thread_free(thread* t) {
+    if (NULL == t) { return -1; }
+    free(t);
+    return 0;
+  }
+
+  int cond_init(cond* c) {
+    if (NULL == c) { return -1; }
+    if (0 != pthread_cond_init(&c->handle, NULL)) { return -2; }
+    return 0;
+  }
+
+  int cond_destroy(cond* c) {
+    if (NULL == c) { return -1; }
+    if (0 != pthread_cond_destroy(&c->handle)) { return -2; }
+    return 0;
+  }
+
+  int cond_wait(cond* c, mutex* m) {
+    if (NULL == c) { return -1; }
+    if (NULL == m) { return -2; }
+    if (0 != pthread_cond_wait(&c->handle, &m->handle)) { return -3; }
+    return 0;
+  }
+
+  int cond_signal(cond* c) {
+    if (NULL == c) { return -1; }
+    if (0 != pthread_cond_signal(&c->handle)) { return -2; }
+    return 0;
+  }
+
+  int cond_broadcast(cond* c) {
+    if (NULL == c) { return -1; }
+    if (0 != pthread_cond_broadcast(&c->handle)) { return -2; }
+    return 0;
+  }
+
+  /* Fails with EPERM when the process isn't allowed to use SCHED_FIFO (no CAP_SYS_NICE or RLIMIT_RTPRIO). */
+  int thread_set_realtime(void) {
+    struct sched_param param;
+    int lo = sched_get_priority_min(SCHED_FIFO);
+    int hi = sched_get_priority_max(SCHED_FIFO);
+    if (-1 == lo || -1 == hi) { return -1; }
+    memset(&param, 0x00, sizeof(param));
+    param.sched_priority = lo + (hi - lo) / 2;
+    if (0 != pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) { return -2; }
+    return 0;
+  }
+
 #endif /* #elif defined(__linux) or defined(__APPLE__) */
 
 /* ----------------------------------------------------------------------------------- */
@@ -167,703 +278,4439 @@
 #  define HAVE_MACH_TIMER
 #  include <mach/mach_time.h>
 #endif
+/* The clock rate, set once per process by `clock_init()` from `global_init()`; `ns()` can't be used before it. */
+#if defined(__APPLE__)
+static mach_timebase_info_data_t clock_info;
+#elif defined(_WIN32)
+static LARGE_INTEGER clock_frequency;
+#endif
+
+static void clock_init(void) {
+#if defined(__APPLE__)
+  mach_timebase_info(&clock_info);
+#elif defined(_WIN32)
+  QueryPerformanceFrequency(&clock_frequency);
+#endif
+}
+
 static uint64_t ns() {
-  static uint64_t is_init = 0;
 #if defined(__APPLE__)
-  static mach_timebase_info_data_t info;
-  if (0 == is_init) {
-    mach_timebase_info(&info);
-    is_init = 1;
-  }
   uint64_t now;
   now = mach_absolute_time();
-  now *= info.numer;
-  now /= info.denom;
+  now *= clock_info.numer;
+  now /= clock_info.denom;
   return now;
 #elif defined(__linux)
-  static struct timespec linux_rate;
-  if (0 == is_init) {
-    clock_getres(CLOCKID, &linux_rate);
-    is_init = 1;
-  }
   uint64_t now;
   struct timespec spec;
   clock_gettime(CLOCKID, &spec);
   now = (uint64_t)(spec.tv_sec * 1000000000 + spec.tv_nsec);
   return now;
 #elif defined(_WIN32)
-  static LARGE_INTEGER win_frequency;
-  if (0 == is_init) {
-    QueryPerformanceFrequency(&win_frequency);
-    is_init = 1;
-  }
   LARGE_INTEGER now;
   QueryPerformanceCounter(&now);
-  return (uint64_t) ((1e9 * now.QuadPart)  / win_frequency.QuadPart);
+  return (uint64_t) ((1e9 * now.QuadPart)  / clock_frequency.QuadPart);
 #endif
 }
 
-/* ----------------------------------------------------------------------------------- */
-/*                          V I D E O   G E N E R A T O  R                             */
-/* ----------------------------------------------------------------------------------- */
+/*
+  Sleeps until `ns()` reaches `deadline`. Because the deadline is
+  absolute, a thread that wakes up periodically doesn't drift when it
+  adds its period to the previous deadline.
+*/
+#if defined(__linux)
+#  include <errno.h>
+#endif
+static void sleep_until(uint64_t deadline) {
+#if defined(__APPLE__)
+  mach_wait_until((deadline * clock_info.denom) / clock_info.numer);
+#elif defined(__linux)
+  struct timespec spec;
+  spec.tv_sec = (time_t)(deadline / 1000000000);
+  spec.tv_nsec = (long)(deadline % 1000000000);
+  while (EINTR == clock_nanosleep(CLOCKID, TIMER_ABSTIME, &spec, NULL)) { }
+#elif defined(_WIN32)
+  /* waitable timers don't use the performance counter so we wait for the time that is left. */
+  LARGE_INTEGER due;
+  HANDLE timer;
+  uint64_t now = ns();
+  if (now >= deadline) { return; }
+  timer = CreateWaitableTimer(NULL, TRUE, NULL);
+  if (NULL == timer) { return; }
+  due.QuadPart = -(LONGLONG)((deadline - now) / 100);
+  if (SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) {
+    WaitForSingleObject(timer, INFINITE);
+  }
+  CloseHandle(timer);
+#endif
+}
 
-#define CLIP(X) ( (X) > 255 ? 255 : (X) < 0 ? 0 : X)
-#define RGB2Y(R, G, B) CLIP(( (  66 * (R) + 129 * (G) +  25 * (B) + 128) >> 8) +  16)
-#define RGB2U(R, G, B) CLIP(( ( -38 * (R) -  74 * (G) + 112 * (B) + 128) >> 8) + 128)
-#define RGB2V(R, G, B) CLIP(( ( 112 * (R) -  94 * (G) -  18 * (B) + 128) >> 8) + 128)
+/*
+  Flags and counters that are shared with the audio thread (and with
+  the readers of a shared memory ring) are read and written atomically
+  so nobody has to take a lock.
+*/
+#if defined(_MSC_VER)
+#  define ATOMIC_LOAD8(p)      ((uint8_t)InterlockedOr8((volatile char*)(p), 0))
+#  define ATOMIC_STORE8(p, v)  InterlockedExchange8((volatile char*)(p), (char)(v))
+#  define ATOMIC_LOAD64(p)     ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0))
+#  define ATOMIC_STORE64(p, v) InterlockedExchange64((volatile LONG64*)(p), (LONG64)(v))
+#  define ATOMIC_ADD64(p, v)   InterlockedExchangeAdd64((volatile LONG64*)(p), (LONG64)(v))
+#  define ATOMIC_FENCE()       MemoryBarrier()
+#else
+#  define ATOMIC_LOAD8(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#  define ATOMIC_STORE8(p, v)  __atomic_store_n((p), (uint8_t)(v), __ATOMIC_RELEASE)
+#  define ATOMIC_LOAD64(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#  define ATOMIC_STORE64(p, v) __atomic_store_n((p), (uint64_t)(v), __ATOMIC_RELEASE)
+#  define ATOMIC_ADD64(p, v)   __atomic_fetch_add((p), (uint64_t)(v), __ATOMIC_RELAXED)
+#  define ATOMIC_FENCE()       __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
 
+/* ----------------------------------------------------------------------------------- */
+/*                          F I L L   K E R N E L S                                    */
+/* ----------------------------------------------------------------------------------- */
 
-// Macro to extract the MSB and LSB for Little Endian
-#define LSB_LE(val)  ((uint8_t)((val) & 0xFF))         // Extract LSB in Little Endian
-#define MSB_LE(val)  ((uint8_t)(((val) >> 8) & 0xFF))  // Extract MSB in Little Endian
+/*
+  Kernels that fill a row with one 16-bit sample. The sample is swizzled
+  once for the requested byte order (see `swizzle16()`) so the kernels
+  only have to store it, a full vector at a time. The 32-bit variants
+  store a u/v pair of 16-bit samples, which is how the interleaved
+  chroma rows of P010 and P016 are filled in a single pass (for NV12 a
+  u/v pair is one 16-bit pattern). The kernels are selected at init,
+  see `select_simd()`.
+*/
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  define HAVE_X86_SIMD
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  endif
+#  include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#  define HAVE_NEON
+#  include <arm_neon.h>
+#endif
 
-// Macro to extract the MSB and LSB for Big Endian
-#define LSB_BE(val)  ((uint8_t)(((val) >> 8) & 0xFF))  // Extract LSB in Big Endian
-#define MSB_BE(val)  ((uint8_t)((val) & 0xFF))         // Extract MSB in Big Endian
+#if defined(__GNUC__) || defined(__clang__)
+#  define TARGET(x) __attribute__((target(x)))
+#else
+#  define TARGET(x)
+#endif
 
-#define MSB(val, be) be ? MSB_BE(val) : MSB_LE(val)
-#define LSB(val, be) be ? LSB_BE(val) : LSB_LE(val)
+static void fill16_c(uint8_t* dst, uint16_t sample, uint32_t nsamples) {
+  uint32_t i;
+  for (i = 0; i < nsamples; ++i) {
+    memcpy(dst + i * 2, &sample, 2);
+  }
+}
 
-static uint64_t numbersfont_pixel_data[] = {0x0,0x0,0xffffffff0000,0x0,0xffffff0000000000,0xffffffffffff,0x0,0x0,0xffffffffffffff00,0xff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffff000000000000,0xffffffffff,0x0,0xff00000000000000,0xffffffffffff,0x0,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffff000000,0xffffff,0x0,0xffffff0000000000,0xffffffff,0x0,0x0,0xff00ffffff000000,0xffffffff,0x0,0x0,0xffffffffff00,0x0,0xffffffffff000000,0xffffffffffffffff,0x0,0xff00000000000000,0xffffffffffffffff,0xffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffff000000,0xffffffffffffffff,0x0,0xffffff0000000000,0xffffffffffffffff,0xff,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffffffff00,0xffffffffffff,0x0,0xffffffffff000000,0xffffffffffffff,0x0,0x0,0xff00ffffffff0000,0xffffffff,0x0,0x0,0xffffffffffff,0x0,0xffffffffffffff00,0xffffffffffffffff,0xffff,0xffffff0000000000,0xffffffffffffffff,0xffffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffffff0000,0xffffffffffffffff,0xff,0xffffffffff000000,0xffffffffffffffff,0xffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xff00000000000000,0xffffffffffffffff,0xffffffffffffff,0x0,0xffffffffffff0000,0xffffffffffffffff,0x0,0x0,0xff00ffffffffff00,0xffffffff,0x0,0xff00000000000000,0xffffffffffff,0x0,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffff00000000,0xffffffffffffffff,0xffffffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffffffff00,0xffffffffffffffff,0xffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffffffffff,0xffffffffffffffff,0xffff,0x0,0xff00ffffffffffff,0xffffffff,0x0,0xff00000000000000,0xffffffffffff,0xff00000000000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffff000000,0xffffffffffffffff,0xffffffffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffffff00,0xffffffffffffffff,0xffffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0xff,0xffffffffffffffff,0xffffffffffffffff,0xffff,0xff00000000000000,0xff00ffffffffffff,0xffffffff,0x0,0xffff000000000000,0xffffffffffff,0xff00000000000000,0xffffffffffff,0xffffff0000000000,0xffffffffff,0xffffffffffff0000,0xff0000000000ffff,0xffffffffffffff,0x0,0x0,0xff00000000000000,0xffffff,0xffffffffffffff,0xffffffff00000000,0xffffff,0xffffffffffffff00,0xffff000000000000,0xffffffffff,0xffffff0000000000,0xffff,0x0,0xffffff0000000000,0xffffffff,0xffffffffff000000,0xff0000000000ffff,0xffffffffffffff,0xffffff0000000000,0xffffff,0xffff000000000000,0xffffffffffff,0x0,0x0,0xffffff0000000000,0xffffffffffff,0xffff000000000000,0xffffffffff,0xff00000000000000,0xffffffffff,0xffffffffffff0000,0x0,0xffffffffffff00,0x0,0x0,0xffff000000000000,0xff0000000000ffff,0xffffffffff,0xffff000000000000,0xffffffff,0xffffffffffff,0xff00000000000000,0xffffffffff,0xffffff0000000000,0xffff,0x0,0xffffff0000000000,0xffffff,0xffffffff00000000,0xffff00000000ffff,0xffffffffff,0xff00000000000000,0xffffffff,0xffffff0000000000,0xffffffffffff,0x0,0x0,0xffffff0000000000,0xffffffffffff,0xffff000000000000,0xffffff,0x0,0xffffffffffff,0xffffffffffff00,0x0,0xffffffffff0000,0x0,0x0,0xffffff0000000000,0xff000000000000ff,0xffffffff,0xff00000000000000,0xffffffff,0xffffffffff,0x0,0xffffffffffff,0xffffffff00000000,0xffff,0x0,0xffffffff00000000,0xffff,0xffffff0000000000,0xffff000000ffffff,0xffffffff,0xff00000000000000,0xffffffff,0xffffffffff000000,0xffffffffffff,0x0,0x0,0xffffffff00000000,0xffffffffffff,0xffffff0000000000,0xffffff,0x0,0xffffffffffff,0xffffffffff00,0x0,0xffffffffffff0000,0x0,0x0,0xffffffff00000000,0xffff000000000000,0xffffffff,0xff00000000000000,0xff0000ffffffffff,0xffffffffff,0x0,0xffffffffff00,0xffffffff00000000,0xff,0x0,0xffffffff00000000,0xff,0xffff000000000000,0xffff000000ffffff,0xffffff,0x0,0xffffffffff,0xffffffffffff0000,0xffffffffffff,0x0,0x0,0xffffffffff000000,0xffffffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0xffffffffffff,0x0,0xffffffffff000000,0x0,0x0,0xffffffffff000000,0xffff000000000000,0xffffff,0x0,0xff0000ffffffffff,0xffffffff,0x0,0xffffffffff00,0xffffffff00000000,0xff,0x0,0xffffffff00000000,0xff,0xffff000000000000,0xffffff0000ffffff,0xffffff,0x0,0xffffffff00,0xffffffffffffffff,0xffffffffff00,0x0,0x0,0xffffffffffff0000,0xffffffffff00,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0xffffffffff,0x0,0x0,0x0,0x0,0xffffffffff0000,0xffff000000000000,0xffffff,0x0,0xffffffffff,0xffffff00,0x0,0xffffffffff00,0xffffffff00000000,0xff,0x0,0xffffffff00000000,0xff,0xffff000000000000,0xffffff0000ffffff,0xffff,0x0,0xff0000ffffffff00,0xffffffffffffff,0xffffffffff00,0x0,0x0,0xffffffffffff0000,0xffffffffff00,0xff00000000000000,0xffff,0x0,0xffffffffff00,0xffffffffff,0x0,0x0,0x0,0x0,0xffffffff0000,0xffff000000000000,0xffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffff00,0xffffffff00000000,0xff,0x0,0xffffffff00000000,0xff,0xffff000000000000,0xffffff0000ffffff,0xffff,0x0,0xff0000ffffffff00,0xffffffffff,0xffffffffff00,0x0,0x0,0xffffffffffff00,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffffff,0x0,0x0,0x0,0x0,0xffffffffff00,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff,0xffffffffff000000,0xff,0x0,0xffffffff00000000,0xffff,0xffffff0000000000,0xffffff0000ffffff,0xffff,0x0,0xff00ffffffffff00,0xffffff,0xffffffffff00,0x0,0x0,0xffffffffffff,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffff,0x0,0x0,0x0,0x0,0xffffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffffff,0xffffffffff000000,0xffffffff000000ff,0xffff,0xffffff0000000000,0xffffff,0xffffff0000000000,0xffffff000000ffff,0xffff,0x0,0xff00ffffffffff00,0xff,0xffffffffff00,0x0,0x0,0xffffffffff,0xffffffffff00,0x0,0x0,0x0,0xff0000ffffffffff,0xffffffff,0xffffffffffff0000,0xff,0x0,0x0,0xffffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffff0000000000,0xffffffff,0xffffffffff000000,0xffffffffffff0000,0xffffffff,0xffff000000000000,0xffffffff,0xffffffffff000000,0xffffff00000000ff,0xffff,0x0,0xffffffffff00,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffffff,0xffffffffff00,0x0,0x0,0x0,0xff0000ffffffffff,0xffffffff,0xffffffffffffffff,0xffffff,0x0,0xff00000000000000,0xffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffffffff00,0xffffff,0xffffffffff000000,0xffffffffffffff00,0xffffffffffff,0xff00000000000000,0xffffffffffffffff,0xffffffffffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffff00,0x0,0xffff000000000000,0xffffffff,0xffffffffff00,0x0,0x0,0xff00000000000000,0xff0000ffffffffff,0xffff0000ffffffff,0xffffffffffffffff,0xffffffffff,0x0,0xff00000000000000,0xffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffffffff00,0xff,0xffffffffff000000,0xffffffffffffffff,0xffffffffffffff,0x0,0xffffffffffffffff,0xffffffffffffff,0xffffff0000000000,0xffffff,0x0,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffff0000000000,0xffffff,0xffffffffff00,0x0,0x0,0xffff000000000000,0xff000000ffffffff,0xffffff00ffffffff,0xffffffffffffffff,0xffffffffffff,0x0,0xffff000000000000,0xffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffffffff00,0xffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffffffff00,0xffffffffffff,0xffff000000000000,0xffffff,0xff00000000000000,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffff0000000000,0xffffff,0xffffffffff00,0x0,0x0,0xffffff0000000000,0xff00000000ffffff,0xffffff00ffffffff,0xffffffffffffffff,0xffffffffffffff,0x0,0xffff000000000000,0xffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffffffff00,0xffffffff,0xffffffffffff0000,0xffff,0xffffffffffffff00,0xff00000000000000,0xffffffffffffffff,0xffffffffffffffff,0xffff000000000000,0xffffffff,0xffff000000000000,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffffff00000000,0xffff,0xffffffffff00,0x0,0x0,0xffffffff00000000,0xff0000000000ffff,0xffffffffffffffff,0xff,0xffffffffffffff,0x0,0xffffff0000000000,0xffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffff00ffff00,0xffffffffff,0xffffffffffff0000,0x0,0xffffffffff000000,0xffff0000000000ff,0xffffffffffffffff,0xffffffffffffffff,0xff000000000000ff,0xffffffffffff,0xffffff0000000000,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffffffff000000,0xff,0xffffffffff00,0x0,0x0,0xffffffffff000000,0xff0000000000ffff,0xffffffffffffff,0x0,0xffffffffffffff00,0x0,0xffffff0000000000,0xffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffffff,0xffffff00000000,0x0,0xffffffff00000000,0xffffff00000000ff,0xffffffff,0xffffffffff000000,0xff0000000000ffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffffffff000000,0x0,0xffffffffff00,0x0,0x0,0xffffffffffff0000,0xff000000000000ff,0xffffffffffff,0x0,0xffffffffffff0000,0x0,0xffffffff00000000,0xff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffffff00,0x0,0x0,0xffffffff00000000,0xffffffff0000ffff,0xffff,0xffffff0000000000,0xffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffff00,0x0,0xffffffffff00,0x0,0xffffffffffff0000,0x0,0xffffffffff00,0x0,0x0,0xffffffffffffff00,0xff00000000000000,0xffffffffff,0x0,0xffffffffff000000,0xff,0xffffffff00000000,0xff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff0000,0x0,0x0,0xffffff0000000000,0xffffffff0000ffff,0xff,0xffff000000000000,0xffffff,0xffffffffffffff00,0xffffffffffffff,0xffffffffff00,0x0,0xffffffffff00,0x0,0xffffffffffff00,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffffffff,0xff00000000000000,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff000000,0x0,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffffff0000,0x0,0x0,0xffffff0000000000,0xffffffff0000ffff,0xff,0xffff000000000000,0xffffff,0xffffffffff000000,0xffffffffff,0xffffffffff00,0x0,0xffffffffff00,0x0,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffff000000000000,0xffffffffff,0xff00000000000000,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff000000,0x0,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff000000,0x0,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0xffffff0000000000,0xffffff,0xffffffffff00,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffff0000000000,0xffffffff,0xff00000000000000,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff000000,0x0,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff000000,0x0,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0x0,0x0,0xffffffffff00,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffff00000000,0xffffff,0xff00000000000000,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff0000,0x0,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff000000,0x0,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0x0,0x0,0xffffffffff,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffff0000,0xffff,0x0,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff0000,0x0,0xffff000000000000,0xffffff,0x0,0xffffffffff,0xffffff00,0x0,0xffffffffff000000,0x0,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0x0,0x0,0xffffffffff,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffffff00,0xff,0x0,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff0000,0x0,0xffff000000000000,0xffffff,0x0,0xff0000ffffffffff,0xffffffff,0x0,0xffffffffff000000,0xffffffffff00,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0x0,0x0,0xffffffffff,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffffff,0x0,0x0,0xffffffffff,0x0,0xffffffffff000000,0xff,0xffffffffff0000,0x0,0xffff000000000000,0xffffff,0x0,0xff0000ffffffffff,0xffffffffff,0x0,0xffffffffffff0000,0xffffffffff00,0x0,0xffffffff00000000,0xffffffffff0000ff,0x0,0xff00000000000000,0xffff0000ffffffff,0xffffff,0xff00000000000000,0xffffffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xff00000000000000,0xffffffffffff,0x0,0x0,0xffffffffff,0x0,0xffffffffff000000,0x0,0xffffffffff00,0x0,0xffff000000000000,0xffffffff,0xff00000000000000,0xff0000ffffffffff,0xffffffffff,0x0,0xffffffffff0000,0xffffffffffff00,0x0,0xffffffff00000000,0xffffffffff0000ff,0xff,0xffff000000000000,0xffff0000ffffffff,0xffffff,0xff00000000000000,0xffffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xff00000000000000,0xffffffffff,0x0,0x0,0xffffffffff00,0x0,0xffffffffffff0000,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffff,0xff00000000000000,0xffffffff,0xffffffffffff,0x0,0xffffffffffff00,0xffffffffff0000,0x0,0xffffffffff000000,0xffffffff000000ff,0xff,0xffff000000000000,0xffff000000ffffff,0xffffffff,0xff00000000000000,0xffffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffff000000000000,0xffffffff,0x0,0x0,0xffffffffffff00,0x0,0xffffffffffffff00,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffffff,0xffff000000000000,0xffffffff,0xffffffffffffff,0x0,0xffffffffffffff,0xffffffffffff0000,0x0,0xffffffffffff0000,0xffffffff00000000,0xffff,0xffffff0000000000,0xff00000000ffffff,0xffffffffff,0xffffff0000000000,0xffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffff0000000000,0xffffff,0x0,0x0,0xffffffffffff0000,0xff,0xffffffffffffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffffffff,0xffffffff00000000,0xffffff,0xffffffffffffff00,0xff00000000000000,0xffffffffffff,0xffffffffff000000,0xffff,0xffffffffffffffff,0xffffff0000000000,0xffffffffff,0xffffffffff000000,0xff0000000000ffff,0xffffffffffff,0xffffffff00000000,0xffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0xffffffffff000000,0xffffffffffffffff,0xffffffffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffffff00,0xffffffffffffffff,0xffffffffff,0xffffffffff000000,0xffffffffffffffff,0xffffffffffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffff,0xffffffffffffffff,0xffffffffffffffff,0xffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0xffffffff00000000,0xffffffffffffffff,0xffffffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffffffff00,0xffffffffffffffff,0xffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffff,0xffffffff00000000,0xffffffffffffffff,0xffffffffffff,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0xff,0xffffffffffffff00,0xffffffffffffffff,0xff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffff00000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffffff0000,0xffffffffffffffff,0xff,0xffffffffff000000,0xffffffffffffffff,0xffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffff,0xff00000000000000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffffffff00,0xffffffffffffffff,0x0,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffff00000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0xffff000000000000,0xffffffffffffffff,0xffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffff000000,0xffffffffffffffff,0x0,0xffffff0000000000,0xffffffffffffffff,0xffff,0xff00000000000000,0xffffffffffffffff,0xffffff,0x0,0xffffffffffffff00,0xffffffffffff,0x0,0xffffffffff000000,0xffffffffffffff,0x0,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffff00000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0x0,0xffffffffffffff00,0x0,0x0,0xffffffffff,0x0,0x0,0xffff000000000000,0xffffffffff,0x0,0xff00000000000000,0xffffffffffffff,0x0,0x0,0xffffffffffffff00,0xff,0x0,0xffffffff00000000,0xffffff,0x0,0xffffff0000000000,0xffffffff,0x0,0x0,0xffffffffff00,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0};
-static int16_t numbersfont_char_data[] = {48,109,0,25,39,3,12,31,49,239,0,15,39,6,12,31,50,28,0,26,39,2,12,31,51,135,0,25,39,3,12,31,52,0,0,27,39,1,12,31,53,161,0,25,39,3,12,31,54,55,0,26,39,2,12,31,55,82,0,26,39,2,12,31,56,187,0,25,39,3,12,31,57,213,0,25,39,3,12,31,58,255,0,5,29,5,22,15};
-static int fill(video_generator* gen, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t r, uint8_t g, uint8_t b);
-static int add_number_string(video_generator* gen, const char* str, uint32_t x, uint32_t y);
-static int add_char(video_generator* gen, video_generator_char* kar, uint32_t x, uint32_t y);
-static void* audio_thread(void* gen); /* When we need to generate audio, we do this in another thread. So be aware that the callback will be called from this thread! */
+static void fill32_c(uint8_t* dst, uint32_t sample, uint32_t nsamples) {
+  uint32_t i;
+  for (i = 0; i < nsamples; ++i) {
+    memcpy(dst + i * 4, &sample, 4);
+  }
+}
 
-#define DEFAULT_WIDTH     640
-#define DEFAULT_HEIGHT    480
-#define DEFAULT_FPS       3
-#define DEFAULT_FORMAT    420
-#define DEFAULT_BITDEPTH  8
-#define DEFAULT_BYTE_ORDER BYTE_ORDER_LITTLE_ENDIAN
+#if defined(HAVE_X86_SIMD)
 
-void select_yuv_format (video_generator* g, video_generator_settings* cfg) {
-  switch (cfg->format) {
-    case 400:
-      g->u_factor = 0.0;
-      g->v_factor = 0.0;
-      break;
-    case 444:
-      g->u_factor = 1.0;
-      g->v_factor = 1.0;
-      break;
-    case 422:
-      g->u_factor = 0.5;
-      g->v_factor = 1.0;
-      break;
-    case 420:
-    default:
-      g->u_factor = 0.5;
-      g->v_factor = 0.5;
+TARGET("sse2") static void fill16_sse2(uint8_t* dst, uint16_t sample, uint32_t nsamples) {
+  __m128i v = _mm_set1_epi16((short)sample);
+  uint32_t i = 0;
+  for (; i + 8 <= nsamples; i += 8) {
+    _mm_storeu_si128((__m128i*)(dst + i * 2), v);
   }
+  fill16_c(dst + i * 2, sample, nsamples - i);
 }
 
-void select_bitdepth (video_generator* g, video_generator_settings* cfg) {
-  switch (cfg->bitdepth) {
-    case 10:
-      g->pixel_size_in_bytes = 2;
-      g->pixel_factor = 4;
-      break;
-    case 12:
-      g->pixel_size_in_bytes = 2;
-      g->pixel_factor = 16;
-      break;
-    case 8:
-    default:
-     g->pixel_size_in_bytes = 1;
-     g->pixel_factor = 1;
+TARGET("avx2") static void fill16_avx2(uint8_t* dst, uint16_t sample, uint32_t nsamples) {
+  __m256i v = _mm256_set1_epi16((short)sample);
+  uint32_t i = 0;
+  for (; i + 16 <= nsamples; i += 16) {
+    _mm256_storeu_si256((__m256i*)(dst + i * 2), v);
   }
+  if (i + 8 <= nsamples) {
+    _mm_storeu_si128((__m128i*)(dst + i * 2), _mm256_castsi256_si128(v));
+    i += 8;
+  }
+  fill16_c(dst + i * 2, sample, nsamples - i);
 }
 
-int video_generator_init(video_generator_settings* cfg, video_generator* g) {
+TARGET("sse2") static void fill32_sse2(uint8_t* dst, uint32_t sample, uint32_t nsamples) {
+  __m128i v = _mm_set1_epi32((int)sample);
+  uint32_t i = 0;
+  for (; i + 4 <= nsamples; i += 4) {
+    _mm_storeu_si128((__m128i*)(dst + i * 4), v);
+  }
+  fill32_c(dst + i * 4, sample, nsamples - i);
+}
 
+TARGET("avx2") static void fill32_avx2(uint8_t* dst, uint32_t sample, uint32_t nsamples) {
+  __m256i v = _mm256_set1_epi32((int)sample);
   uint32_t i = 0;
-  uint32_t dx = 0;
-  uint32_t max_els = RXS_MAX_CHARS * 8; /* members per char */
-  video_generator_char* c = NULL;
-  uint32_t num_frames; /* used for bip/bop calculations. */
+  for (; i + 8 <= nsamples; i += 8) {
+    _mm256_storeu_si256((__m256i*)(dst + i * 4), v);
+  }
+  if (i + 4 <= nsamples) {
+    _mm_storeu_si128((__m128i*)(dst + i * 4), _mm256_castsi256_si128(v));
+    i += 4;
+  }
+  fill32_c(dst + i * 4, sample, nsamples - i);
+}
 
-  if (!g) { return -1; }
-  if (!cfg) { return -2; }
-  if (!cfg->width) { cfg->width = DEFAULT_WIDTH; }
-  if (!cfg->height) { cfg->height = DEFAULT_HEIGHT; }
-  if (!cfg->fps) { cfg->fps = DEFAULT_FPS; }
-  if (!cfg->format) { cfg->format = DEFAULT_FORMAT; }
-  if (!cfg->bitdepth) { cfg->bitdepth = DEFAULT_BITDEPTH; }
-  if (!cfg->byte_order) { cfg->byte_order = DEFAULT_BYTE_ORDER; }
-  if (!cfg->onecolor) { cfg->onecolor = 0; }
+#endif /* HAVE_X86_SIMD */
 
-  /* initalize members */
-  g->frame = 0;
-  select_yuv_format(g, cfg);
-  select_bitdepth(g, cfg);
-  g->ybytes = cfg->width * cfg->height * g->pixel_size_in_bytes;
-  g->ubytes = (uint32_t)(cfg->width * g->u_factor) * (uint32_t)(cfg->height * g->v_factor) * g->pixel_size_in_bytes;
-  g->vbytes = g->ubytes;
-  g->nbytes = g->ybytes + g->ubytes + g->vbytes;
+#if defined(HAVE_NEON)
 
-  g->width = cfg->width;
-  g->height = cfg->height;
-  g->fps = (1.0 / cfg->fps) * 1000 * 1000;
+static void fill16_neon(uint8_t* dst, uint16_t sample, uint32_t nsamples) {
+  uint16x8_t v = vdupq_n_u16(sample);
+  uint32_t i = 0;
+  for (; i + 16 <= nsamples; i += 16) {
+    vst1q_u8(dst + i * 2, vreinterpretq_u8_u16(v));
+    vst1q_u8(dst + i * 2 + 16, vreinterpretq_u8_u16(v));
+  }
+  for (; i + 8 <= nsamples; i += 8) {
+    vst1q_u8(dst + i * 2, vreinterpretq_u8_u16(v));
+  }
+  fill16_c(dst + i * 2, sample, nsamples - i);
+}
 
-  g->y = (uint8_t*)malloc(g->nbytes);
-  g->u = g->y + g->ybytes;
-  g->v = g->u + g->ubytes;
+static void fill32_neon(uint8_t* dst, uint32_t sample, uint32_t nsamples) {
+  uint32x4_t v = vdupq_n_u32(sample);
+  uint32_t i = 0;
+  for (; i + 8 <= nsamples; i += 8) {
+    vst1q_u8(dst + i * 4, vreinterpretq_u8_u32(v));
+    vst1q_u8(dst + i * 4 + 16, vreinterpretq_u8_u32(v));
+  }
+  for (; i + 4 <= nsamples; i += 4) {
+    vst1q_u8(dst + i * 4, vreinterpretq_u8_u32(v));
+  }
+  fill32_c(dst + i * 4, sample, nsamples - i);
+}
 
-  g->step = (1.0 / (5 * cfg->fps)); /* move the bar in 5 seconds from top to bottom */
-  g->perc = 0.0;
-  g->fps_num = 1;
-  g->fps_den = cfg->fps;
-  g->byte_order = cfg->byte_order;
-  g->onecolor = cfg->onecolor;
+#endif /* HAVE_NEON */
 
-  /* initialize the characters */
-  while (i < max_els) {
-    c = &g->chars[dx];
-    c->id = (char)numbersfont_char_data[i++];
-    c->x = (uint32_t)numbersfont_char_data[i++];
-    c->y = (uint32_t)numbersfont_char_data[i++];
-    c->width = (uint32_t)numbersfont_char_data[i++];
-    c->height = (uint32_t)numbersfont_char_data[i++];
-    c->xoffset = (uint32_t)numbersfont_char_data[i++];
-    c->yoffset = (uint32_t)numbersfont_char_data[i++];
-    c->xadvance = (uint32_t)numbersfont_char_data[i++];
-    dx++;
-  }
+/*
+  Kernels of the stress patterns, see `draw_pattern()`. `noise` fills a
+  row with the lowbias32 hash of consecutive 32-bit counters: every
+  word only depends on its counter and the key, so the rows come out
+  the same whichever thread renders them and in whatever order. The
+  gradient and the zone plate produce 8-bit values with byte and 16-bit
+  lane arithmetic; `widen` converts them into 16-bit samples (and
+  interleaves the u and v values) when the output has more bits.
+*/
+static uint32_t lowbias32(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352dU;
+  x ^= x >> 15;
+  x *= 0x846ca68bU;
+  x ^= x >> 16;
+  return x;
+}
 
-  /* bitmap font specifics */
-  g->font_w = 264;
-  g->font_h = 50;
-  g->font_line_height = 63;
+static void noise_c(uint8_t* dst, uint32_t nbytes, uint32_t counter, uint32_t key, uint32_t mask) {
+  uint32_t i, w;
+  for (i = 0; i + 4 <= nbytes; i += 4, ++counter) {
+    w = lowbias32(counter ^ key) & mask;
+    memcpy(dst + i, &w, 4);
+  }
+  if (i < nbytes) {
+    w = lowbias32(counter ^ key) & mask;
+    memcpy(dst + i, &w, nbytes - i);
+  }
+}
 
-  /* default audio settings. */
-  g->audio_bip_frequency = 0;
-  g->audio_bop_frequency = 0;
-  g->audio_nchannels = 0;
-  g->audio_samplerate = 0;
-  g->audio_nbytes = 0;
-  g->audio_buffer = NULL;
-  g->audio_callback = NULL;
-  g->audio_thread = NULL;
+/* A ramp along x with a xor texture on top; `y` moves the texture and `add` the ramp. */
+static void gradient_c(uint8_t* dst, uint32_t n, uint32_t x, uint8_t y, uint8_t add) {
+  uint32_t i;
+  uint8_t v;
+  for (i = 0; i < n; ++i, ++x) {
+    v = (uint8_t)x;
+    dst[i] = (uint8_t)(v + add + ((v ^ y) & 63));
+  }
+}
 
-  /* initialize audio */
-  if (NULL != cfg->audio_callback) {
+/* A triangle wave of the top 9 bits of the 16-bit phase. */
+static void zone_c(uint8_t* dst, const uint16_t* phase, uint32_t n, uint16_t add) {
+  uint32_t i, p;
+  for (i = 0; i < n; ++i) {
+    p = (uint16_t)(phase[i] + add) >> 7;
+    dst[i] = (uint8_t)((p & 256) ? ~p : p);
+  }
+}
 
-    if (0 == cfg->bip_frequency) {
-      printf("Error: audio_callback set but no bip_frequency set. Use e.g. 500.");
-      return -6;
+/* Scales `n` 8-bit values by `factor` into 16-bit samples in the output byte order, u/v pairs when `b` is set. */
+static void widen_c(uint8_t* dst, const uint8_t* a, const uint8_t* b, uint32_t n, uint16_t factor, uint8_t swap) {
+  uint32_t i;
+  uint16_t sa, sb;
+  for (i = 0; i < n; ++i) {
+    sa = (uint16_t)(a[i] * factor);
+    sa = (uint16_t)((1 == swap) ? ((sa >> 8) | (sa << 8)) : sa);
+    if (NULL == b) {
+      memcpy(dst + i * 2, &sa, 2);
+      continue;
     }
+    sb = (uint16_t)(b[i] * factor);
+    sb = (uint16_t)((1 == swap) ? ((sb >> 8) | (sb << 8)) : sb);
+    memcpy(dst + i * 4, &sa, 2);
+    memcpy(dst + i * 4 + 2, &sb, 2);
+  }
+}
 
-    if (0 == cfg->bop_frequency) {
-      printf("Error: audio_callback set but no bop_frequency set. Use e.g. 1500.");
-      return -7;
-    }
+#if defined(HAVE_X86_SIMD)
 
-    /* we allocate a buffer up to 4 seconds. */
-    g->audio_bip_frequency = cfg->bip_frequency;
-    g->audio_bop_frequency = cfg->bop_frequency;
-    g->audio_bip_millis = 100;
-    g->audio_bop_millis = 100;
-    g->audio_nchannels = 2;
-    g->audio_samplerate = 44100;
-    g->audio_nsamples = 1024;
-    g->audio_nseconds = 4;
-    g->audio_nbytes = sizeof(int16_t) * g->audio_samplerate * g->audio_nchannels * g->audio_nseconds;
-    g->audio_callback = cfg->audio_callback;
+/* `_mm_mullo_epi32()` is SSE4.1, multiply the even and the odd lanes with `_mm_mul_epu32()` instead. */
+TARGET("sse2") static __m128i mullo32_sse2(__m128i a, __m128i b) {
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
 
-    /* alloc the buffer. */
-    g->audio_buffer = (int16_t*)malloc(g->audio_nbytes);
-    if (!g->audio_buffer) {
-      printf("Error while allocating the audio buffer.");
-      g->audio_buffer = NULL;
-      return -7;
-    }
+TARGET("sse2") static __m128i lowbias32_sse2(__m128i x) {
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+  x = mullo32_sse2(x, _mm_set1_epi32(0x7feb352d));
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+  x = mullo32_sse2(x, _mm_set1_epi32((int)0x846ca68bU));
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+  return x;
+}
 
-    /* fill with silence */
-    memset((uint8_t*)g->audio_buffer, 0x00, g->audio_nbytes);
+TARGET("sse2") static void noise_sse2(uint8_t* dst, uint32_t nbytes, uint32_t counter, uint32_t key, uint32_t mask) {
+  __m128i k = _mm_set1_epi32((int)key);
+  __m128i m = _mm_set1_epi32((int)mask);
+  __m128i c = _mm_add_epi32(_mm_set1_epi32((int)counter), _mm_setr_epi32(0, 1, 2, 3));
+  __m128i step = _mm_set1_epi32(4);
+  uint32_t i = 0;
+  for (; i + 16 <= nbytes; i += 16) {
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(lowbias32_sse2(_mm_xor_si128(c, k)), m));
+    c = _mm_add_epi32(c, step);
+  }
+  noise_c(dst + i, nbytes - i, counter + i / 4, key, mask);
+}
 
-    /* bip */
-    dx= 0;
-    num_frames = (uint32_t)(g->audio_bip_millis/1000.0) * g->audio_samplerate;
-    for (i = g->audio_samplerate;  i < (g->audio_samplerate + num_frames); ++i) {
-      dx = i * 2;
-      g->audio_buffer[dx + 0] =  (int16_t)(10000 * sin( (6.28318530718/g->audio_samplerate) * g->audio_bip_frequency * i));
-      g->audio_buffer[dx + 1] = g->audio_buffer[dx + 0];
-    }
+TARGET("avx2") static __m256i lowbias32_avx2(__m256i x) {
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+  x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7feb352d));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+  x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x846ca68bU));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+  return x;
+}
 
-    /* bop */
-    num_frames = (uint32_t)(g->audio_bip_millis/1000.0) * g->audio_samplerate;
-    for (i = (g->audio_samplerate * 3); i < (g->audio_samplerate * 3 + num_frames); ++i) {
-      dx = i * 2;
-      g->audio_buffer[dx + 0] = (int16_t)(10000 * sin( (6.28318530718/g->audio_samplerate) * g->audio_bop_frequency * i));
-      g->audio_buffer[dx + 1] = g->audio_buffer[dx + 0];
-    }
+TARGET("avx2") static void noise_avx2(uint8_t* dst, uint32_t nbytes, uint32_t counter, uint32_t key, uint32_t mask) {
+  __m256i k = _mm256_set1_epi32((int)key);
+  __m256i m = _mm256_set1_epi32((int)mask);
+  __m256i c = _mm256_add_epi32(_mm256_set1_epi32((int)counter), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  __m256i step = _mm256_set1_epi32(8);
+  uint32_t i = 0;
+  for (; i + 32 <= nbytes; i += 32) {
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(lowbias32_avx2(_mm256_xor_si256(c, k)), m));
+    c = _mm256_add_epi32(c, step);
+  }
+  noise_c(dst + i, nbytes - i, counter + i / 4, key, mask);
+}
 
-    /* init mutex. */
-    if (0 != mutex_init(&g->audio_mutex)) {
-      printf("Error: cannot initialize the audio mutex!");
-      free(g->audio_buffer);
-      g->audio_buffer = NULL;
-      return -8;
-    }
+TARGET("sse2") static void gradient_sse2(uint8_t* dst, uint32_t n, uint32_t x, uint8_t y, uint8_t add) {
+  __m128i v = _mm_add_epi8(_mm_set1_epi8((char)x), _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+  __m128i vy = _mm_set1_epi8((char)y);
+  __m128i va = _mm_set1_epi8((char)add);
+  __m128i m = _mm_set1_epi8(63);
+  __m128i step = _mm_set1_epi8(16);
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi8(_mm_add_epi8(v, va), _mm_and_si128(_mm_xor_si128(v, vy), m)));
+    v = _mm_add_epi8(v, step);
+  }
+  gradient_c(dst + i, n - i, x + i, y, add);
+}
 
-    /* start audio thread. */
-    g->audio_thread = thread_alloc(audio_thread, (void*)g);
-    if (NULL == g->audio_thread) {
-      printf("Error: cannot create audio thread.\n");
-      free(g->audio_buffer);
-      g->audio_buffer = NULL;
-      return -9;
-    }
+TARGET("avx2") static void gradient_avx2(uint8_t* dst, uint32_t n, uint32_t x, uint8_t y, uint8_t add) {
+  __m256i v = _mm256_add_epi8(_mm256_set1_epi8((char)x), _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                                                           16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31));
+  __m256i vy = _mm256_set1_epi8((char)y);
+  __m256i va = _mm256_set1_epi8((char)add);
+  __m256i m = _mm256_set1_epi8(63);
+  __m256i step = _mm256_set1_epi8(32);
+  uint32_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi8(_mm256_add_epi8(v, va), _mm256_and_si256(_mm256_xor_si256(v, vy), m)));
+    v = _mm256_add_epi8(v, step);
   }
+  gradient_c(dst + i, n - i, x + i, y, add);
+}
 
-  return 0;
+/* 8 values of the zone plate in the low bytes of the 16-bit lanes. */
+TARGET("sse2") static __m128i zone8_sse2(const uint16_t* phase, __m128i add) {
+  __m128i p = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*)phase), add), 7);
+  __m128i flip = _mm_srai_epi16(_mm_slli_epi16(p, 7), 15);
+  return _mm_and_si128(_mm_xor_si128(p, flip), _mm_set1_epi16(0xff));
 }
 
-int video_generator_clear(video_generator* g) {
+TARGET("sse2") static void zone_sse2(uint8_t* dst, const uint16_t* phase, uint32_t n, uint16_t add) {
+  __m128i a = _mm_set1_epi16((short)add);
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(zone8_sse2(phase + i, a), zone8_sse2(phase + i + 8, a)));
+  }
+  zone_c(dst + i, phase + i, n - i, add);
+}
 
-  /* stop the audio thread if it's running. */
-  if (NULL != g->audio_thread) {
-    mutex_lock(&g->audio_mutex);
-      g->audio_thread_must_stop = 1;
-    mutex_unlock(&g->audio_mutex);
-    thread_join(g->audio_thread);
-    g->audio_thread = NULL;
+TARGET("avx2") static __m256i zone16_avx2(const uint16_t* phase, __m256i add) {
+  __m256i p = _mm256_srli_epi16(_mm256_add_epi16(_mm256_loadu_si256((const __m256i*)phase), add), 7);
+  __m256i flip = _mm256_srai_epi16(_mm256_slli_epi16(p, 7), 15);
+  return _mm256_and_si256(_mm256_xor_si256(p, flip), _mm256_set1_epi16(0xff));
+}
 
-    /* free the audio buffer. */
-    if (NULL != g->audio_buffer) {
-      free(g->audio_buffer);
-      g->audio_buffer = NULL;
+TARGET("avx2") static void zone_avx2(uint8_t* dst, const uint16_t* phase, uint32_t n, uint16_t add) {
+  __m256i a = _mm256_set1_epi16((short)add);
+  uint32_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    /* packus works per 128-bit lane, put the 64-bit quarters back in order. */
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(zone16_avx2(phase + i, a), zone16_avx2(phase + i + 16, a)), 0xD8));
+  }
+  zone_c(dst + i, phase + i, n - i, add);
+}
+
+TARGET("sse2") static __m128i scale16_sse2(__m128i v, __m128i factor, uint8_t swap) {
+  v = _mm_mullo_epi16(v, factor);
+  return (1 == swap) ? _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)) : v;
+}
+
+/* Used for AVX2 too, the loads and stores are what it costs. */
+TARGET("sse2") static void widen_sse2(uint8_t* dst, const uint8_t* a, const uint8_t* b, uint32_t n, uint16_t factor, uint8_t swap) {
+  __m128i f = _mm_set1_epi16((short)factor);
+  __m128i zero = _mm_setzero_si128();
+  __m128i va, alo, ahi, vb, blo, bhi;
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    va = _mm_loadu_si128((const __m128i*)(a + i));
+    alo = scale16_sse2(_mm_unpacklo_epi8(va, zero), f, swap);
+    ahi = scale16_sse2(_mm_unpackhi_epi8(va, zero), f, swap);
+    if (NULL == b) {
+      _mm_storeu_si128((__m128i*)(dst + i * 2), alo);
+      _mm_storeu_si128((__m128i*)(dst + i * 2 + 16), ahi);
+      continue;
+    }
+    vb = _mm_loadu_si128((const __m128i*)(b + i));
+    blo = scale16_sse2(_mm_unpacklo_epi8(vb, zero), f, swap);
+    bhi = scale16_sse2(_mm_unpackhi_epi8(vb, zero), f, swap);
+    _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_unpacklo_epi16(alo, blo));
+    _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_unpackhi_epi16(alo, blo));
+    _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_unpacklo_epi16(ahi, bhi));
+    _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_unpackhi_epi16(ahi, bhi));
+  }
+  widen_c(dst + i * ((NULL == b) ? 2 : 4), a + i, (NULL == b) ? NULL : b + i, n - i, factor, swap);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+#if defined(HAVE_NEON)
+
+static uint32x4_t lowbias32_neon(uint32x4_t x) {
+  x = veorq_u32(x, vshrq_n_u32(x, 16));
+  x = vmulq_u32(x, vdupq_n_u32(0x7feb352dU));
+  x = veorq_u32(x, vshrq_n_u32(x, 15));
+  x = vmulq_u32(x, vdupq_n_u32(0x846ca68bU));
+  x = veorq_u32(x, vshrq_n_u32(x, 16));
+  return x;
+}
+
+static void noise_neon(uint8_t* dst, uint32_t nbytes, uint32_t counter, uint32_t key, uint32_t mask) {
+  static const uint32_t lanes[4] = { 0, 1, 2, 3 };
+  uint32x4_t k = vdupq_n_u32(key);
+  uint32x4_t m = vdupq_n_u32(mask);
+  uint32x4_t c = vaddq_u32(vdupq_n_u32(counter), vld1q_u32(lanes));
+  uint32x4_t step = vdupq_n_u32(4);
+  uint32_t i = 0;
+  for (; i + 16 <= nbytes; i += 16) {
+    vst1q_u8(dst + i, vreinterpretq_u8_u32(vandq_u32(lowbias32_neon(veorq_u32(c, k)), m)));
+    c = vaddq_u32(c, step);
+  }
+  noise_c(dst + i, nbytes - i, counter + i / 4, key, mask);
+}
+
+static void gradient_neon(uint8_t* dst, uint32_t n, uint32_t x, uint8_t y, uint8_t add) {
+  static const uint8_t lanes[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+  uint8x16_t v = vaddq_u8(vdupq_n_u8((uint8_t)x), vld1q_u8(lanes));
+  uint8x16_t vy = vdupq_n_u8(y);
+  uint8x16_t va = vdupq_n_u8(add);
+  uint8x16_t m = vdupq_n_u8(63);
+  uint8x16_t step = vdupq_n_u8(16);
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    vst1q_u8(dst + i, vaddq_u8(vaddq_u8(v, va), vandq_u8(veorq_u8(v, vy), m)));
+    v = vaddq_u8(v, step);
+  }
+  gradient_c(dst + i, n - i, x + i, y, add);
+}
+
+static uint8x8_t zone8_neon(const uint16_t* phase, uint16x8_t add) {
+  uint16x8_t p = vshrq_n_u16(vaddq_u16(vld1q_u16(phase), add), 7);
+  return vmovn_u16(veorq_u16(p, vtstq_u16(p, vdupq_n_u16(256))));
+}
+
+static void zone_neon(uint8_t* dst, const uint16_t* phase, uint32_t n, uint16_t add) {
+  uint16x8_t a = vdupq_n_u16(add);
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    vst1q_u8(dst + i, vcombine_u8(zone8_neon(phase + i, a), zone8_neon(phase + i + 8, a)));
+  }
+  zone_c(dst + i, phase + i, n - i, add);
+}
+
+static uint16x8_t scale16_neon(uint8x8_t v, uint16_t factor, uint8_t swap) {
+  uint16x8_t s = vmulq_n_u16(vmovl_u8(v), factor);
+  return (1 == swap) ? vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(s))) : s;
+}
+
+static void widen_neon(uint8_t* dst, const uint8_t* a, const uint8_t* b, uint32_t n, uint16_t factor, uint8_t swap) {
+  uint16x8x2_t uv;
+  uint8x8_t vb;
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    if (NULL == b) {
+      vst1q_u16((uint16_t*)(dst + i * 2), scale16_neon(vld1_u8(a + i), factor, swap));
+      continue;
+    }
+    vb = vld1_u8(b + i);
+    uv.val[0] = scale16_neon(vld1_u8(a + i), factor, swap);
+    uv.val[1] = scale16_neon(vb, factor, swap);
+    vst2q_u16((uint16_t*)(dst + i * 4), uv);
+  }
+  widen_c(dst + i * ((NULL == b) ? 2 : 4), a + i, (NULL == b) ? NULL : b + i, n - i, factor, swap);
+}
+
+#endif /* HAVE_NEON */
+
+int video_generator_has_simd(uint8_t level) {
+
+  switch (level) {
+    case VIDEO_GENERATOR_SIMD_AUTO:
+    case VIDEO_GENERATOR_SIMD_NONE: {
+      return 1;
+    }
+#if defined(HAVE_X86_SIMD)
+    case VIDEO_GENERATOR_SIMD_SSE2: {
+#  if defined(__x86_64__) || defined(_M_X64)
+      return 1;
+#  elif defined(_MSC_VER)
+      int info[4];
+      __cpuid(info, 1);
+      return (info[3] & (1 << 26)) ? 1 : 0;
+#  else
+      return __builtin_cpu_supports("sse2") ? 1 : 0;
+#  endif
+    }
+    case VIDEO_GENERATOR_SIMD_AVX2: {
+#  if defined(_MSC_VER)
+      int info[4];
+      __cpuid(info, 0);
+      if (info[0] < 7) { return 0; }
+      __cpuid(info, 1);
+      if (0 == (info[2] & (1 << 27)) || 0 == (info[2] & (1 << 28))) { return 0; } /* OSXSAVE and AVX */
+      if (6 != (_xgetbv(0) & 6)) { return 0; }                                     /* the OS saves the YMM registers */
+      __cpuidex(info, 7, 0);
+      return (info[1] & (1 << 5)) ? 1 : 0;
+#  else
+      return __builtin_cpu_supports("avx2") ? 1 : 0;
+#  endif
+    }
+#endif
+#if defined(HAVE_NEON)
+    case VIDEO_GENERATOR_SIMD_NEON: {
+      return 1;
+    }
+#endif
+    default: {
+      return 0;
+    }
+  }
+}
+
+/* Selects the fill and pattern kernels, returns the selected level or -1 when the requested one isn't available. */
+static int select_simd(video_generator* g, uint8_t level) {
+
+  if (VIDEO_GENERATOR_SIMD_AUTO == level) {
+#if defined(HAVE_X86_SIMD)
+    level = video_generator_has_simd(VIDEO_GENERATOR_SIMD_AVX2) ? VIDEO_GENERATOR_SIMD_AVX2
+          : video_generator_has_simd(VIDEO_GENERATOR_SIMD_SSE2) ? VIDEO_GENERATOR_SIMD_SSE2
+          : VIDEO_GENERATOR_SIMD_NONE;
+#elif defined(HAVE_NEON)
+    level = VIDEO_GENERATOR_SIMD_NEON;
+#else
+    level = VIDEO_GENERATOR_SIMD_NONE;
+#endif
+  }
+
+  if (0 == video_generator_has_simd(level)) {
+    return -1;
+  }
+
+  switch (level) {
+#if defined(HAVE_X86_SIMD)
+    case VIDEO_GENERATOR_SIMD_SSE2: {
+      g->fill16 = fill16_sse2; g->fill32 = fill32_sse2;
+      g->noise = noise_sse2; g->gradient = gradient_sse2; g->zone = zone_sse2; g->widen = widen_sse2;
+      break;
+    }
+    case VIDEO_GENERATOR_SIMD_AVX2: {
+      g->fill16 = fill16_avx2; g->fill32 = fill32_avx2;
+      g->noise = noise_avx2; g->gradient = gradient_avx2; g->zone = zone_avx2; g->widen = widen_sse2;
+      break;
+    }
+#endif
+#if defined(HAVE_NEON)
+    case VIDEO_GENERATOR_SIMD_NEON: {
+      g->fill16 = fill16_neon; g->fill32 = fill32_neon;
+      g->noise = noise_neon; g->gradient = gradient_neon; g->zone = zone_neon; g->widen = widen_neon;
+      break;
+    }
+#endif
+    default: {
+      g->fill16 = fill16_c; g->fill32 = fill32_c;
+      g->noise = noise_c; g->gradient = gradient_c; g->zone = zone_c; g->widen = widen_c;
+      break;
+    }
+  }
+
+  g->simd = level;
+
+  return level;
+}
+
+/* ----------------------------------------------------------------------------------- */
+/*                          V I D E O   G E N E R A T O  R                             */
+/* ----------------------------------------------------------------------------------- */
+
+#ifndef MIN
+#  define MIN(A, B) ((A) < (B) ? (A) : (B))
+#endif
+#ifndef MAX
+#  define MAX(A, B) ((A) > (B) ? (A) : (B))
+#endif
+#define CLIP(X) ( (X) > 255 ? 255 : (X) < 0 ? 0 : X)
+#define RGB2Y(R, G, B) CLIP(( (  66 * (R) + 129 * (G) +  25 * (B) + 128) >> 8) +  16)
+#define RGB2U(R, G, B) CLIP(( ( -38 * (R) -  74 * (G) + 112 * (B) + 128) >> 8) + 128)
+#define RGB2V(R, G, B) CLIP(( ( 112 * (R) -  94 * (G) -  18 * (B) + 128) >> 8) + 128)
+
+
+// Macro to extract the MSB and LSB for Little Endian
+#define LSB_LE(val)  ((uint8_t)((val) & 0xFF))         // Extract LSB in Little Endian
+#define MSB_LE(val)  ((uint8_t)(((val) >> 8) & 0xFF))  // Extract MSB in Little Endian
+
+// Macro to extract the MSB and LSB for Big Endian
+#define LSB_BE(val)  ((uint8_t)(((val) >> 8) & 0xFF))  // Extract LSB in Big Endian
+#define MSB_BE(val)  ((uint8_t)((val) & 0xFF))         // Extract MSB in Big Endian
+
+#define MSB(val, be) be ? MSB_BE(val) : MSB_LE(val)
+#define LSB(val, be) be ? LSB_BE(val) : LSB_LE(val)
+
+/* Returns the sample in native order such that storing it writes the bytes in `byte_order`. */
+static uint16_t swizzle16(uint16_t val, uint8_t byte_order) {
+  uint8_t bytes[2];
+  uint16_t result;
+  bytes[0] = LSB(val, byte_order);
+  bytes[1] = MSB(val, byte_order);
+  memcpy(&result, bytes, 2);
+  return result;
+}
+
+static const uint64_t numbersfont_pixel_data[] = {0x0,0x0,0xffffffff0000,0x0,0xffffff0000000000,0xffffffffffff,0x0,0x0,0xffffffffffffff00,0xff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffff000000000000,0xffffffffff,0x0,0xff00000000000000,0xffffffffffff,0x0,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffff000000,0xffffff,0x0,0xffffff0000000000,0xffffffff,0x0,0x0,0xff00ffffff000000,0xffffffff,0x0,0x0,0xffffffffff00,0x0,0xffffffffff000000,0xffffffffffffffff,0x0,0xff00000000000000,0xffffffffffffffff,0xffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffff000000,0xffffffffffffffff,0x0,0xffffff0000000000,0xffffffffffffffff,0xff,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffffffff00,0xffffffffffff,0x0,0xffffffffff000000,0xffffffffffffff,0x0,0x0,0xff00ffffffff0000,0xffffffff,0x0,0x0,0xffffffffffff,0x0,0xffffffffffffff00,0xffffffffffffffff,0xffff,0xffffff0000000000,0xffffffffffffffff,0xffffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffffff0000,0xffffffffffffffff,0xff,0xffffffffff000000,0xffffffffffffffff,0xffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xff00000000000000,0xffffffffffffffff,0xffffffffffffff,0x0,0xffffffffffff0000,0xffffffffffffffff,0x0,0x0,0xff00ffffffffff00,0xffffffff,0x0,0xff00000000000000,0xffffffffffff,0x0,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffff00000000,0xffffffffffffffff,0xffffffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffffffff00,0xffffffffffffffff,0xffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffffffffff,0xffffffffffffffff,0xffff,0x0,0xff00ffffffffffff,0xffffffff,0x0,0xff00000000000000,0xffffffffffff,0xff00000000000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffff000000,0xffffffffffffffff,0xffffffffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffffff00,0xffffffffffffffff,0xffffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0xff,0xffffffffffffffff,0xffffffffffffffff,0xffff,0xff00000000000000,0xff00ffffffffffff,0xffffffff,0x0,0xffff000000000000,0xffffffffffff,0xff00000000000000,0xffffffffffff,0xffffff0000000000,0xffffffffff,0xffffffffffff0000,0xff0000000000ffff,0xffffffffffffff,0x0,0x0,0xff00000000000000,0xffffff,0xffffffffffffff,0xffffffff00000000,0xffffff,0xffffffffffffff00,0xffff000000000000,0xffffffffff,0xffffff0000000000,0xffff,0x0,0xffffff0000000000,0xffffffff,0xffffffffff000000,0xff0000000000ffff,0xffffffffffffff,0xffffff0000000000,0xffffff,0xffff000000000000,0xffffffffffff,0x0,0x0,0xffffff0000000000,0xffffffffffff,0xffff000000000000,0xffffffffff,0xff00000000000000,0xffffffffff,0xffffffffffff0000,0x0,0xffffffffffff00,0x0,0x0,0xffff000000000000,0xff0000000000ffff,0xffffffffff,0xffff000000000000,0xffffffff,0xffffffffffff,0xff00000000000000,0xffffffffff,0xffffff0000000000,0xffff,0x0,0xffffff0000000000,0xffffff,0xffffffff00000000,0xffff00000000ffff,0xffffffffff,0xff00000000000000,0xffffffff,0xffffff0000000000,0xffffffffffff,0x0,0x0,0xffffff0000000000,0xffffffffffff,0xffff000000000000,0xffffff,0x0,0xffffffffffff,0xffffffffffff00,0x0,0xffffffffff0000,0x0,0x0,0xffffff0000000000,0xff000000000000ff,0xffffffff,0xff00000000000000,0xffffffff,0xffffffffff,0x0,0xffffffffffff,0xffffffff00000000,0xffff,0x0,0xffffffff00000000,0xffff,0xffffff0000000000,0xffff000000ffffff,0xffffffff,0xff00000000000000,0xffffffff,0xffffffffff000000,0xffffffffffff,0x0,0x0,0xffffffff00000000,0xffffffffffff,0xffffff0000000000,0xffffff,0x0,0xffffffffffff,0xffffffffff00,0x0,0xffffffffffff0000,0x0,0x0,0xffffffff00000000,0xffff000000000000,0xffffffff,0xff00000000000000,0xff0000ffffffffff,0xffffffffff,0x0,0xffffffffff00,0xffffffff00000000,0xff,0x0,0xffffffff00000000,0xff,0xffff000000000000,0xffff000000ffffff,0xffffff,0x0,0xffffffffff,0xffffffffffff0000,0xffffffffffff,0x0,0x0,0xffffffffff000000,0xffffffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0xffffffffffff,0x0,0xffffffffff000000,0x0,0x0,0xffffffffff000000,0xffff000000000000,0xffffff,0x0,0xff0000ffffffffff,0xffffffff,0x0,0xffffffffff00,0xffffffff00000000,0xff,0x0,0xffffffff00000000,0xff,0xffff000000000000,0xffffff0000ffffff,0xffffff,0x0,0xffffffff00,0xffffffffffffffff,0xffffffffff00,0x0,0x0,0xffffffffffff0000,0xffffffffff00,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0xffffffffff,0x0,0x0,0x0,0x0,0xffffffffff0000,0xffff000000000000,0xffffff,0x0,0xffffffffff,0xffffff00,0x0,0xffffffffff00,0xffffffff00000000,0xff,0x0,0xffffffff00000000,0xff,0xffff000000000000,0xffffff0000ffffff,0xffff,0x0,0xff0000ffffffff00,0xffffffffffffff,0xffffffffff00,0x0,0x0,0xffffffffffff0000,0xffffffffff00,0xff00000000000000,0xffff,0x0,0xffffffffff00,0xffffffffff,0x0,0x0,0x0,0x0,0xffffffff0000,0xffff000000000000,0xffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffff00,0xffffffff00000000,0xff,0x0,0xffffffff00000000,0xff,0xffff000000000000,0xffffff0000ffffff,0xffff,0x0,0xff0000ffffffff00,0xffffffffff,0xffffffffff00,0x0,0x0,0xffffffffffff00,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffffff,0x0,0x0,0x0,0x0,0xffffffffff00,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff,0xffffffffff000000,0xff,0x0,0xffffffff00000000,0xffff,0xffffff0000000000,0xffffff0000ffffff,0xffff,0x0,0xff00ffffffffff00,0xffffff,0xffffffffff00,0x0,0x0,0xffffffffffff,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffff,0x0,0x0,0x0,0x0,0xffffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffffff,0xffffffffff000000,0xffffffff000000ff,0xffff,0xffffff0000000000,0xffffff,0xffffff0000000000,0xffffff000000ffff,0xffff,0x0,0xff00ffffffffff00,0xff,0xffffffffff00,0x0,0x0,0xffffffffff,0xffffffffff00,0x0,0x0,0x0,0xff0000ffffffffff,0xffffffff,0xffffffffffff0000,0xff,0x0,0x0,0xffffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffff0000000000,0xffffffff,0xffffffffff000000,0xffffffffffff0000,0xffffffff,0xffff000000000000,0xffffffff,0xffffffffff000000,0xffffff00000000ff,0xffff,0x0,0xffffffffff00,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffffff,0xffffffffff00,0x0,0x0,0x0,0xff0000ffffffffff,0xffffffff,0xffffffffffffffff,0xffffff,0x0,0xff00000000000000,0xffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffffffff00,0xffffff,0xffffffffff000000,0xffffffffffffff00,0xffffffffffff,0xff00000000000000,0xffffffffffffffff,0xffffffffffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffff00,0x0,0xffff000000000000,0xffffffff,0xffffffffff00,0x0,0x0,0xff00000000000000,0xff0000ffffffffff,0xffff0000ffffffff,0xffffffffffffffff,0xffffffffff,0x0,0xff00000000000000,0xffffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffffffff00,0xff,0xffffffffff000000,0xffffffffffffffff,0xffffffffffffff,0x0,0xffffffffffffffff,0xffffffffffffff,0xffffff0000000000,0xffffff,0x0,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffff0000000000,0xffffff,0xffffffffff00,0x0,0x0,0xffff000000000000,0xff000000ffffffff,0xffffff00ffffffff,0xffffffffffffffff,0xffffffffffff,0x0,0xffff000000000000,0xffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffffffff00,0xffffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffffffff00,0xffffffffffff,0xffff000000000000,0xffffff,0xff00000000000000,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffff0000000000,0xffffff,0xffffffffff00,0x0,0x0,0xffffff0000000000,0xff00000000ffffff,0xffffff00ffffffff,0xffffffffffffffff,0xffffffffffffff,0x0,0xffff000000000000,0xffffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffffffffff00,0xffffffff,0xffffffffffff0000,0xffff,0xffffffffffffff00,0xff00000000000000,0xffffffffffffffff,0xffffffffffffffff,0xffff000000000000,0xffffffff,0xffff000000000000,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffffff00000000,0xffff,0xffffffffff00,0x0,0x0,0xffffffff00000000,0xff0000000000ffff,0xffffffffffffffff,0xff,0xffffffffffffff,0x0,0xffffff0000000000,0xffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0xffffffff00ffff00,0xffffffffff,0xffffffffffff0000,0x0,0xffffffffff000000,0xffff0000000000ff,0xffffffffffffffff,0xffffffffffffffff,0xff000000000000ff,0xffffffffffff,0xffffff0000000000,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffffffff000000,0xff,0xffffffffff00,0x0,0x0,0xffffffffff000000,0xff0000000000ffff,0xffffffffffffff,0x0,0xffffffffffffff00,0x0,0xffffff0000000000,0xffff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffffff,0xffffff00000000,0x0,0xffffffff00000000,0xffffff00000000ff,0xffffffff,0xffffffffff000000,0xff0000000000ffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffffffffff000000,0x0,0xffffffffff00,0x0,0x0,0xffffffffffff0000,0xff000000000000ff,0xffffffffffff,0x0,0xffffffffffff0000,0x0,0xffffffff00000000,0xff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffffff00,0x0,0x0,0xffffffff00000000,0xffffffff0000ffff,0xffff,0xffffff0000000000,0xffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffff00,0x0,0xffffffffff00,0x0,0xffffffffffff0000,0x0,0xffffffffff00,0x0,0x0,0xffffffffffffff00,0xff00000000000000,0xffffffffff,0x0,0xffffffffff000000,0xff,0xffffffff00000000,0xff,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff0000,0x0,0x0,0xffffff0000000000,0xffffffff0000ffff,0xff,0xffff000000000000,0xffffff,0xffffffffffffff00,0xffffffffffffff,0xffffffffff00,0x0,0xffffffffff00,0x0,0xffffffffffff00,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffffffff,0xff00000000000000,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff000000,0x0,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffffff0000,0x0,0x0,0xffffff0000000000,0xffffffff0000ffff,0xff,0xffff000000000000,0xffffff,0xffffffffff000000,0xffffffffff,0xffffffffff00,0x0,0xffffffffff00,0x0,0xffffffffffff,0x0,0xffffffffff00,0x0,0xffff000000000000,0xffffffffff,0xff00000000000000,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff000000,0x0,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff000000,0x0,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0xffffff0000000000,0xffffff,0xffffffffff00,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffff0000000000,0xffffffff,0xff00000000000000,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff000000,0x0,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff000000,0x0,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0x0,0x0,0xffffffffff00,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffff00000000,0xffffff,0xff00000000000000,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff0000,0x0,0xffffff0000000000,0xffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffff000000,0x0,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0x0,0x0,0xffffffffff,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffff0000,0xffff,0x0,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff0000,0x0,0xffff000000000000,0xffffff,0x0,0xffffffffff,0xffffff00,0x0,0xffffffffff000000,0x0,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0x0,0x0,0xffffffffff,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffffff00,0xff,0x0,0xffffffff,0x0,0xffffffff00000000,0xff,0xffffffffff0000,0x0,0xffff000000000000,0xffffff,0x0,0xff0000ffffffffff,0xffffffff,0x0,0xffffffffff000000,0xffffffffff00,0x0,0xffffff0000000000,0xffffffffff00ffff,0x0,0xff00000000000000,0xffffffff,0x0,0x0,0xffffffffff,0x0,0xff00ffffffffff00,0xffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffffff,0x0,0x0,0xffffffffff,0x0,0xffffffffff000000,0xff,0xffffffffff0000,0x0,0xffff000000000000,0xffffff,0x0,0xff0000ffffffffff,0xffffffffff,0x0,0xffffffffffff0000,0xffffffffff00,0x0,0xffffffff00000000,0xffffffffff0000ff,0x0,0xff00000000000000,0xffff0000ffffffff,0xffffff,0xff00000000000000,0xffffffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xff00000000000000,0xffffffffffff,0x0,0x0,0xffffffffff,0x0,0xffffffffff000000,0x0,0xffffffffff00,0x0,0xffff000000000000,0xffffffff,0xff00000000000000,0xff0000ffffffffff,0xffffffffff,0x0,0xffffffffff0000,0xffffffffffff00,0x0,0xffffffff00000000,0xffffffffff0000ff,0xff,0xffff000000000000,0xffff0000ffffffff,0xffffff,0xff00000000000000,0xffffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xff00000000000000,0xffffffffff,0x0,0x0,0xffffffffff00,0x0,0xffffffffffff0000,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffff,0xff00000000000000,0xffffffff,0xffffffffffff,0x0,0xffffffffffff00,0xffffffffff0000,0x0,0xffffffffff000000,0xffffffff000000ff,0xff,0xffff000000000000,0xffff000000ffffff,0xffffffff,0xff00000000000000,0xffffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffff000000000000,0xffffffff,0x0,0x0,0xffffffffffff00,0x0,0xffffffffffffff00,0x0,0xffffffffff00,0x0,0xff00000000000000,0xffffffffff,0xffff000000000000,0xffffffff,0xffffffffffffff,0x0,0xffffffffffffff,0xffffffffffff0000,0x0,0xffffffffffff0000,0xffffffff00000000,0xffff,0xffffff0000000000,0xff00000000ffffff,0xffffffffff,0xffffff0000000000,0xffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffff0000000000,0xffffff,0x0,0x0,0xffffffffffff0000,0xff,0xffffffffffffff,0x0,0xffffffffff00,0x0,0x0,0xffffffffffffff,0xffffffff00000000,0xffffff,0xffffffffffffff00,0xff00000000000000,0xffffffffffff,0xffffffffff000000,0xffff,0xffffffffffffffff,0xffffff0000000000,0xffffffffff,0xffffffffff000000,0xff0000000000ffff,0xffffffffffff,0xffffffff00000000,0xffffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0xffffffffff000000,0xffffffffffffffff,0xffffffffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffffffffff,0xffffffffffffffff,0xffffff,0xffffffffffffff00,0xffffffffffffffff,0xffffffffff,0xffffffffff000000,0xffffffffffffffff,0xffffffffffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffff,0xffffffffffffffff,0xffffffffffffffff,0xffff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffff0000000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0xffffffff00000000,0xffffffffffffffff,0xffffffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffffffff00,0xffffffffffffffff,0xffff,0xffffffffffff0000,0xffffffffffffffff,0xffffffff,0xffffffff00000000,0xffffffffffffffff,0xffffffffffff,0xffff000000000000,0xffffffffffffffff,0xffffffffffffffff,0xff,0xffffffffffffff00,0xffffffffffffffff,0xff,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffff00000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffffff0000,0xffffffffffffffff,0xff,0xffffffffff000000,0xffffffffffffffff,0xffffff,0xffffff0000000000,0xffffffffffffffff,0xffffffffff,0xff00000000000000,0xffffffffffffffff,0xffffffffffffffff,0x0,0xffffffffffffff00,0xffffffffffffffff,0x0,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffff00000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0xffff000000000000,0xffffffffffffffff,0xffffff,0x0,0xffffffffff,0x0,0x0,0xffffffffff000000,0xffffffffffffffff,0x0,0xffffff0000000000,0xffffffffffffffff,0xffff,0xff00000000000000,0xffffffffffffffff,0xffffff,0x0,0xffffffffffffff00,0xffffffffffff,0x0,0xffffffffff000000,0xffffffffffffff,0x0,0x0,0xffffffffff00,0x0,0x0,0x0,0xffffffffff00,0xffffffff00000000,0xffffffffffffffff,0xffffffffffffffff,0xffffffffffff,0x0,0xffffffffffffff00,0x0,0x0,0xffffffffff,0x0,0x0,0xffff000000000000,0xffffffffff,0x0,0xff00000000000000,0xffffffffffffff,0x0,0x0,0xffffffffffffff00,0xff,0x0,0xffffffff00000000,0xffffff,0x0,0xffffff0000000000,0xffffffff,0x0,0x0,0xffffffffff00,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0,0x0};
+static const int16_t numbersfont_char_data[] = {48,109,0,25,39,3,12,31,49,239,0,15,39,6,12,31,50,28,0,26,39,2,12,31,51,135,0,25,39,3,12,31,52,0,0,27,39,1,12,31,53,161,0,25,39,3,12,31,54,55,0,26,39,2,12,31,55,82,0,26,39,2,12,31,56,187,0,25,39,3,12,31,57,213,0,25,39,3,12,31,58,255,0,5,29,5,22,15};
+/* The rows of a frame that a render thread draws into. */
+typedef struct render_band {
+  uint32_t y0;                                            /* first y-plane row. */
+  uint32_t y1;                                            /* one past the last y-plane row. */
+  uint32_t uv_y0;                                         /* first u/v-plane row. */
+  uint32_t uv_y1;                                         /* one past the last u/v-plane row. */
+} render_band;
+
+/* What the renditions of `video_generator_multi_update()` share for a frame. */
+typedef struct render_timeline {
+  uint8_t  is_bip;
+  uint8_t  is_bop;
+  uint64_t now;                                           /* the time stamp of the frame id. */
+} render_timeline;
+
+/* Everything that is drawn into a frame, computed once per frame by `render()` and then drawn per band. */
+typedef struct render_job {
+  video_generator* g;
+  uint8_t* planes[3];                                     /* the y, u and v planes we render into. */
+  uint32_t strides[3];                                    /* bytes between two rows of each plane. */
+  uint8_t  onecolor;                                      /* fill the complete frame with `color`. */
+  video_generator_color color;
+  uint8_t  full_restore;                                  /* copy the complete background into the frame. */
+  uint8_t  pattern;                                       /* the VIDEO_GENERATOR_PATTERN_* that covers the complete frame instead of the background and bar. */
+  uint64_t pattern_frame;                                 /* the frame number that the pattern is drawn for. */
+  uint32_t noise_key;                                     /* the key of the noise hash for this frame, see `set_pattern()`. */
+  uint32_t restore[2][2];                                 /* y-plane rows [from, to) that are restored from the background. */
+  uint32_t uv_restore[2][2];                              /* u/v-plane rows [from, to) that are restored from the background. */
+  uint32_t bar_y;                                         /* first y-plane row of the moving bar. */
+  uint32_t bar_h;                                         /* number of y-plane rows of the moving bar. */
+  video_generator_color bar_color;
+  uint8_t  timed;                                         /* 1 when the stages are added to `frame_stage_ns` of the generator. */
+  uint8_t  with_text;                                     /* 1 when the frame is big enough to draw the text box. */
+  uint8_t  with_id;                                       /* 1 when the frame id is drawn. */
+  uint8_t  id[RXS_ID_BYTES];                              /* the bytes of the frame id, see `make_frame_id()`. */
+  uint32_t text_x;                                        /* position of the cached `text_box` in the y-plane. */
+  uint32_t text_y;
+  uint32_t max_bands;                                     /* split the frame in at most this many bands, the number of render threads. */
+  uint32_t nbands;                                        /* number of bands, at most `max_bands`. */
+  uint32_t band[RXS_MAX_THREADS + 1];                     /* y-plane row at which each band starts. */
+} render_job;
+
+#define RXS_MAX_BATCH 16 /* number of frames that are drawn together, at least RXS_MAX_RENDITIONS. */
+#define RXS_POOL_RESERVED 2 /* `in_use` of a pool buffer that `video_generator_update_n()` took but didn't hand out yet. */
+
+/* The jobs of several frames whose bands are drawn together, see `draw_batch()`. */
+typedef struct render_batch {
+  render_job jobs[RXS_MAX_BATCH];
+  uint64_t start[RXS_MAX_BATCH];                          /* when each frame started, for the stats. */
+  uint32_t nbands;                                        /* the number of bands that are queued. */
+  uint8_t job_of[RXS_MAX_BATCH * RXS_MAX_THREADS];        /* the job of each band that the render threads pick up. */
+  uint8_t band_of[RXS_MAX_BATCH * RXS_MAX_THREADS];       /* the band of the job. */
+} render_batch;
+
+/* The functions that depend on the format and sample size, selected once at init by `select_kernels()`. */
+struct video_generator_kernels {
+  void(*fill)(video_generator* g, uint8_t* const* planes, const uint32_t* strides, const render_band* band, uint32_t x, uint32_t y, uint32_t w, uint32_t h, const video_generator_color* c); /* fills a rectangle of the y-plane and the matching part of the u/v-planes. */
+};
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#  define PRINTF_FORMAT(fmt, args)
+#endif
+
+static void global_init(void);
+static void global_init_once(void);
+static void log_error(const char* fmt, ...) PRINTF_FORMAT(1, 2);
+static void make_color(video_generator* g, uint8_t r, uint8_t gc, uint8_t b, video_generator_color* out);
+static void select_kernels(video_generator* g, uint32_t format);
+static void restore_rows(uint8_t* dst, uint32_t dst_stride, const uint8_t* src, uint32_t src_stride, uint32_t from, uint32_t to);
+static void copy_frame(video_generator* g, uint8_t* const* planes, const uint32_t* strides, const uint8_t* src);
+static void plane_strides(video_generator* g, uint32_t* strides);
+static void free_pool(video_generator* g);
+static uint8_t* alloc_frame(video_generator* g, size_t nbytes);
+static void free_frame(video_generator* g, uint8_t* frame, size_t nbytes);
+static size_t frame_alloc_bytes(video_generator* g, size_t nbytes);
+static uint8_t* map_frame(video_generator* g, size_t nbytes);
+static void unmap_frame(uint8_t* frame, size_t nbytes);
+static int numa_node_cpus(uint32_t node, void* cpus);
+static void copy_rect(uint8_t* dst, uint32_t dst_stride, const uint8_t* src, uint32_t src_stride, uint32_t y, uint32_t h, uint32_t from, uint32_t to);
+static void compose_text_box(video_generator* g, uint8_t* const* planes, const uint32_t* strides, uint32_t x, uint32_t y, uint64_t frame, uint32_t color);
+static void update_text_box(video_generator* g, uint64_t frame, uint32_t color);
+static int layout_bar(video_generator* g, double perc, double next, render_job* job);
+static double next_perc(video_generator* g);
+static void frame_bip_bop(video_generator* g, uint64_t frame, uint8_t* is_bip, uint8_t* is_bop);
+static void range_bip_bop(video_generator* g, uint64_t start, uint64_t nframes, uint8_t* is_bip, uint8_t* is_bop);
+static void tone_window(video_generator* g, uint32_t tone, uint64_t* start, uint64_t* end);
+static uint32_t text_color_index(uint8_t is_bip, uint8_t is_bop);
+static int render(video_generator* g, uint8_t* const* planes, const uint32_t* strides, video_generator_dirty* dirty); /* renders the next frame into `planes` and advances the generator. */
+static uint64_t stats_frame_start(video_generator* g);
+static int prepare_frame(video_generator* g, uint8_t* const* planes, const uint32_t* strides, video_generator_dirty* dirty, const render_timeline* timeline, render_job* job);
+static void finish_frame(video_generator* g, render_job* job, uint64_t start);
+static void flush_batch(video_generator* g, render_batch* batch, uint32_t njobs);
+static void settle_pool(video_generator* g, uint32_t n, video_generator_frame** frames, uint8_t keep);
+static uint32_t text_box_key(video_generator* g, uint32_t text_color);
+static void batch_add(render_batch* b, uint32_t index);
+static void draw_batch(video_generator_workers* w, render_batch* b);
+static void draw_batch_band(void* user, uint32_t index);
+static void split_bands(video_generator* g, render_job* job);
+static int build_cycle(video_generator* g);
+static const uint8_t* serve_cycle(video_generator* g);
+static void draw_band(void* user, uint32_t index);
+static void stage_done(render_job* job, uint32_t stage, uint64_t* t);
+static void stats_frame_done(video_generator* g, uint64_t start);
+static void make_frame_id(uint64_t frame, uint64_t timestamp, uint8_t* id);
+static uint16_t crc16(const uint8_t* data, uint32_t nbytes);
+static void draw_frame_id(render_job* job, const render_band* band);
+static void init_pattern(video_generator* g);
+static void set_pattern(video_generator* g, uint64_t frame, render_job* job);
+static void draw_pattern(render_job* job, const render_band* band);
+static void pattern_row(render_job* job, uint32_t plane, uint32_t row, uint8_t* dst);
+static void pattern_values(render_job* job, uint32_t plane, uint32_t row, uint32_t x, uint32_t n, uint8_t* dst);
+static void stats_audio_callback(video_generator* g, uint64_t duration);
+static void stats_audio_wakeup(video_generator* g, uint64_t jitter);
+static void pacing_add(video_generator_pacing* p, uint64_t late);
+static video_generator_workers* workers_alloc(uint32_t nthreads);
+static void audio_tick(video_generator* g);
+static void* timer_thread(void* user);
+static void context_join(video_generator_context* ctx, video_generator* g, uint8_t audio);
+static void context_leave(video_generator* g);
+static int workers_bind(video_generator_workers* w, uint32_t node);
+static int workers_free(video_generator_workers* w);
+static void workers_run(video_generator_workers* w, uint32_t njobs, void(*func)(void* user, uint32_t index), void* user);
+static int shm_map(video_generator_shm* shm, const char* name, uint64_t nbytes, uint8_t create);
+static void shm_unmap(video_generator_shm* shm);
+static void ring_write(video_generator* g, const uint8_t* src, uint32_t nframes);
+static void synth_audio(video_generator* g, uint64_t pos, uint32_t nframes, uint8_t* dst);
+static void synth_tone(video_generator* g, uint8_t* dst, uint16_t frequency, uint64_t offset, uint32_t nframes);
+static void offline_audio(video_generator* g);
+static void* audio_thread(void* gen); /* When we need to generate audio, we do this in another thread. So be aware that the callback will be called from this thread! */
+
+static const uint8_t bg_colors[] = {
+  255, 255, 255,  // white
+  255, 255, 0,    // yellow
+  0,   255, 255,  // cyan
+  0,   255, 0,    // green
+  255, 0,   255,  // magenta
+  255, 0,   0,    // red
+  0,   0,   255   // blue
+};
+
+#define RXS_MIN_BAND_ROWS 32 /* don't split the work into bands smaller than this. */
+#define RXS_COLOR_TEXT    7  /* index in the palette of the text box color, 0-6 are the background bars. */
+#define RXS_COLOR_BIP     8  /* index in the palette of the text box color when we play the bip. */
+#define RXS_COLOR_BOP     9  /* index in the palette of the text box color when we play the bop. */
+#define RXS_TEXT_W        170 /* width of the text box with time stamps, manually measured. */
+#define RXS_TEXT_H        100 /* height of the text box with time stamps. */
+#define RXS_TEXT_PAD      20  /* position of the time stamp in the text box. */
+#define RXS_AUDIO_RING_FRAMES 65536 /* capacity of the pull mode audio ring, must be a power of two. */
+#define RXS_AUDIO_AMPLITUDE (10000.0 / 32768.0) /* peak of the bip and bop tones relative to full scale. */
+#define RXS_SYNTH_BLOCK   256 /* number of samples the tone synthesizer computes before converting them, a multiple of 4. */
+#define RXS_PAGE_SIZE     4096 /* alignment of the frame buffers. */
+#define RXS_FONT_W        264 /* width of the numbers font bitmap. */
+#define RXS_FONT_H        50  /* height of the numbers font bitmap. */
+#define RXS_MAX_LOG_MESSAGE 512 /* longer messages are truncated. */
+#define RXS_TIMER_IDLE    10000000 /* how long the timer thread of a context sleeps when it has nothing to deliver, in ns. */
+#define RXS_HUGE_PAGE_SIZE (2 * 1024 * 1024) /* frame buffers with VIDEO_GENERATOR_ALLOC_HUGEPAGES span whole huge pages. */
+#define RXS_MAX_NUMA_NODES 64 /* `numa_node` must be smaller. */
+
+#define DEFAULT_WIDTH     640
+#define DEFAULT_HEIGHT    480
+#define DEFAULT_FPS       3
+#define DEFAULT_FORMAT    420
+#define DEFAULT_BITDEPTH  8
+#define DEFAULT_BYTE_ORDER BYTE_ORDER_LITTLE_ENDIAN
+
+void select_yuv_format (video_generator* g, video_generator_settings* cfg) {
+  g->uv_interleaved = 0;
+  switch (cfg->format) {
+    case 400:
+      g->u_factor = 0.0;
+      g->v_factor = 0.0;
+      g->uv_shift_x = 0;
+      g->uv_shift_y = 0;
+      break;
+    case VIDEO_GENERATOR_FORMAT_NV12:
+      g->u_factor = 0.5;
+      g->v_factor = 0.5;
+      g->uv_shift_x = 1;
+      g->uv_shift_y = 1;
+      g->uv_interleaved = 1;
+      break;
+    case 444:
+      g->u_factor = 1.0;
+      g->v_factor = 1.0;
+      g->uv_shift_x = 0;
+      g->uv_shift_y = 0;
+      break;
+    case 422:
+      g->u_factor = 0.5;
+      g->v_factor = 1.0;
+      g->uv_shift_x = 1;
+      g->uv_shift_y = 0;
+      break;
+    case 420:
+    default:
+      g->u_factor = 0.5;
+      g->v_factor = 0.5;
+      g->uv_shift_x = 1;
+      g->uv_shift_y = 1;
+  }
+}
+
+void select_bitdepth (video_generator* g, video_generator_settings* cfg) {
+  switch (cfg->bitdepth) {
+    case 10:
+      g->pixel_size_in_bytes = 2;
+      g->pixel_factor = 4;
+      break;
+    case 12:
+      g->pixel_size_in_bytes = 2;
+      g->pixel_factor = 16;
+      break;
+    case 16:
+      g->pixel_size_in_bytes = 2;
+      g->pixel_factor = 256;
+      break;
+    case 8:
+    default:
+     g->pixel_size_in_bytes = 1;
+     g->pixel_factor = 1;
+  }
+  /* P010 and P016 store the samples in the high bits, e.g. a 10-bit sample is shifted left by 6. */
+  if (1 == g->uv_interleaved && 2 == g->pixel_size_in_bytes) {
+    g->pixel_factor = 256;
+  }
+}
+
+/*
+  State that all generators of the process share. It's written once by
+  `global_init()` and read-only from then on, except for the log
+  callback which is protected by `log_mutex`.
+*/
+static video_generator_char font_chars[RXS_MAX_CHARS];            /* the characters of the font, `offset` is in `font_atlas`. */
+static uint8_t font_atlas[RXS_FONT_W * RXS_FONT_H];               /* the 8-bit glyphs of all characters, row by row. */
+static uint32_t font_atlas_bytes;                                 /* bytes used in `font_atlas`. */
+static mutex log_mutex;
+static video_generator_log_callback log_callback;                 /* where `log_error()` sends the messages, stdout when NULL. */
+static void* log_user;
+
+#if defined(_WIN32)
+static INIT_ONCE global_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK global_init_win32(PINIT_ONCE once, PVOID param, PVOID* context) {
+  (void)once;
+  (void)param;
+  (void)context;
+  global_init();
+  return TRUE;
+}
+
+static void global_init_once(void) {
+  InitOnceExecuteOnce(&global_once, global_init_win32, NULL, NULL);
+}
+#else
+static pthread_once_t global_once = PTHREAD_ONCE_INIT;
+
+static void global_init_once(void) {
+  pthread_once(&global_once, global_init);
+}
+#endif
+
+/* Initializes the clock and decodes the font, once per process. */
+static void global_init(void) {
+
+  const int16_t* data = numbersfont_char_data;
+  const uint8_t* src;
+  video_generator_char* c;
+  uint32_t i, j;
+
+  clock_init();
+  mutex_init(&log_mutex);
+
+  font_atlas_bytes = 0;
+  for (i = 0; i < RXS_MAX_CHARS; ++i, data += 8) {
+    c = &font_chars[i];
+    c->id = (char)data[0];
+    c->x = (uint32_t)data[1];
+    c->y = (uint32_t)data[2];
+    c->width = (uint32_t)data[3];
+    c->height = (uint32_t)data[4];
+    c->xoffset = (uint32_t)data[5];
+    c->yoffset = (uint32_t)data[6];
+    c->xadvance = (uint32_t)data[7];
+    c->offset = font_atlas_bytes;
+    for (j = 0; j < c->height; ++j) {
+      src = (const uint8_t*)numbersfont_pixel_data + (c->y + j) * RXS_FONT_W + c->x;
+      memcpy(font_atlas + font_atlas_bytes, src, c->width);
+      font_atlas_bytes += c->width;
+    }
+  }
+}
+
+/* Formats a message and passes it to the log callback, or prints it on stdout when there is none. */
+static void log_error(const char* fmt, ...) {
+
+  char msg[RXS_MAX_LOG_MESSAGE];
+  video_generator_log_callback callback;
+  void* user;
+  va_list args;
+
+  global_init_once();
+
+  va_start(args, fmt);
+  vsnprintf(msg, sizeof(msg), fmt, args);
+  va_end(args);
+
+  mutex_lock(&log_mutex);
+    callback = log_callback;
+    user = log_user;
+  mutex_unlock(&log_mutex);
+
+  if (NULL == callback) {
+    printf("%s\n", msg);
+    return;
+  }
+
+  callback(user, msg);
+}
+
+void video_generator_set_log_callback(video_generator_log_callback callback, void* user) {
+
+  global_init_once();
+
+  mutex_lock(&log_mutex);
+    log_callback = callback;
+    log_user = user;
+  mutex_unlock(&log_mutex);
+}
+
+int video_generator_init(video_generator_settings* cfg, video_generator* g) {
+
+  uint32_t i = 0;
+  uint32_t dx = 0;
+  uint32_t uv_w, uv_h;
+  uint32_t glyph_bytes = 0;
+  uint32_t sample_bytes = 0;
+  uint32_t period = 0;
+  uint16_t sample;
+  uint8_t* bg_planes[3];
+  uint32_t bg_strides[3];
+  double perc;
+  render_band band;
+
+  if (!g) { return -1; }
+  if (!cfg) { return -2; }
+
+  global_init_once();
+
+  if (!cfg->width) { cfg->width = DEFAULT_WIDTH; }
+  if (!cfg->height) { cfg->height = DEFAULT_HEIGHT; }
+  if (!cfg->fps) { cfg->fps = DEFAULT_FPS; }
+  if (!cfg->format) { cfg->format = DEFAULT_FORMAT; }
+  if (!cfg->bitdepth) { cfg->bitdepth = DEFAULT_BITDEPTH; }
+  if (!cfg->byte_order) { cfg->byte_order = DEFAULT_BYTE_ORDER; }
+  if (!cfg->onecolor) { cfg->onecolor = 0; }
+
+  if (0 != (cfg->alloc_flags & VIDEO_GENERATOR_ALLOC_NUMA) && 0 != numa_node_cpus(cfg->numa_node, NULL)) {
+    log_error("Error: numa node %u is not available.", cfg->numa_node);
+    return -19;
+  }
+
+  if (cfg->pattern > VIDEO_GENERATOR_PATTERN_ZONEPLATE
+      || (VIDEO_GENERATOR_PATTERN_BARS != cfg->pattern && (0 != cfg->onecolor || 0 != cfg->cycle_cache)))
+  {
+    log_error("Error: use one of the VIDEO_GENERATOR_PATTERN_* values, a pattern can't be combined with onecolor or the cycle cache.");
+    return -18;
+  }
+
+  if (0 != cfg->cycle_cache && 0 == cfg->onecolor && 0 == cfg->no_timestamp) {
+    log_error("Error: the cycle cache needs periodic content, set onecolor or no_timestamp.");
+    return -15;
+  }
+
+  if (0 != cfg->cycle_cache && 0 != cfg->frame_id) {
+    log_error("Error: the cycle cache can't be used with frame ids, every frame is different.");
+    return -15;
+  }
+
+  if (0 != cfg->frame_id && (cfg->width < RXS_ID_COLS * RXS_ID_BLOCK || cfg->height < RXS_ID_ROWS * RXS_ID_BLOCK)) {
+    log_error("Error: the frame id needs a frame of at least %dx%d.", RXS_ID_COLS * RXS_ID_BLOCK, RXS_ID_ROWS * RXS_ID_BLOCK);
+    return -17;
+  }
+
+  if (cfg->audio_nchannels > RXS_MAX_AUDIO_CHANNELS
+      || cfg->audio_format > VIDEO_GENERATOR_AUDIO_F32
+      || cfg->audio_nsamples > RXS_MAX_AUDIO_PERIOD)
+  {
+    log_error("Error: use at most %d audio channels, one of the VIDEO_GENERATOR_AUDIO_S16, S32 or F32 formats and at most %d frames per chunk.",
+           RXS_MAX_AUDIO_CHANNELS, RXS_MAX_AUDIO_PERIOD);
+    return -16;
+  }
+
+  if (NULL != cfg->audio_callback || VIDEO_GENERATOR_AUDIO_CALLBACK != cfg->audio_mode) {
+
+    if (0 == cfg->bip_frequency) {
+      log_error("Error: audio enabled but no bip_frequency set. Use e.g. 500.");
+      return -6;
+    }
+
+    if (0 == cfg->bop_frequency) {
+      log_error("Error: audio enabled but no bop_frequency set. Use e.g. 1500.");
+      return -7;
+    }
+  }
+
+  /* initalize members */
+  g->frame = 0;
+  if (0 > select_simd(g, cfg->simd)) {
+    log_error("Error: the requested simd level %u is not supported by this cpu.", cfg->simd);
+    return -11;
+  }
+  select_yuv_format(g, cfg);
+  select_bitdepth(g, cfg);
+  select_kernels(g, cfg->format);
+  g->uv_width = (400 == cfg->format) ? 0 : cfg->width >> g->uv_shift_x;
+  g->uv_height = (400 == cfg->format) ? 0 : cfg->height >> g->uv_shift_y;
+  g->ybytes = cfg->width * cfg->height * g->pixel_size_in_bytes;
+  g->ubytes = (g->uv_width * g->uv_height * g->pixel_size_in_bytes) << g->uv_interleaved;
+  g->vbytes = (1 == g->uv_interleaved) ? 0 : g->ubytes;
+  g->nbytes = g->ybytes + g->ubytes + g->vbytes;
+
+  g->width = cfg->width;
+  g->height = cfg->height;
+  g->fps = (1.0 / cfg->fps) * 1000 * 1000;
+  g->alloc_flags = cfg->alloc_flags;
+  g->numa_node = cfg->numa_node;
+
+  g->y = alloc_frame(g, g->nbytes);
+  if (!g->y) {
+    log_error("Error: cannot allocate the frame buffer.");
+    return -3;
+  }
+  g->u = g->y + g->ybytes;
+  g->v = (1 == g->uv_interleaved) ? NULL : g->u + g->ubytes;
+
+  g->step = (1.0 / (5 * cfg->fps)); /* move the bar in 5 seconds from top to bottom */
+  g->perc = 0.0;
+  g->fps_num = 1;
+  g->fps_den = cfg->fps;
+  g->byte_order = cfg->byte_order;
+  g->format = cfg->format;
+  g->bitdepth = cfg->bitdepth;
+  g->onecolor = cfg->onecolor;
+  g->stats_enabled = (0 != cfg->stats) ? 1 : 0;
+  g->no_timestamp = (0 != cfg->no_timestamp) ? 1 : 0;
+  g->frame_id = (0 != cfg->frame_id) ? 1 : 0;
+  g->pattern = cfg->pattern;
+  g->seed = cfg->seed;
+  g->cycle = NULL;
+  g->cycle_frames = 0;
+  memset(&g->stats, 0x00, sizeof(g->stats));
+  memset(g->frame_stage_ns, 0x00, sizeof(g->frame_stage_ns));
+  memset(&g->pacing, 0x00, sizeof(g->pacing));
+  g->pace_started = 0;
+  g->pace_start_ns = 0;
+  g->pace_start_frame = 0;
+
+  /* convert the colors that we use into samples once. */
+  for (i = 0; i < 7; ++i) {
+    make_color(g, bg_colors[i * 3 + 0], bg_colors[i * 3 + 1], bg_colors[i * 3 + 2], &g->palette[i]);
+  }
+  make_color(g, 0, 0, 0, &g->palette[RXS_COLOR_TEXT]);
+  make_color(g, 0, 0, 255, &g->palette[RXS_COLOR_BIP]);
+  make_color(g, 255, 0, 0, &g->palette[RXS_COLOR_BOP]);
+  make_color(g, 0, 0, 0, &g->id_colors[0]);
+  make_color(g, 255, 255, 255, &g->id_colors[1]);
+
+  /* render the static background once, `video_generator_update()` only restores the rows that changed. */
+  g->bg = NULL;
+  memset(&g->dirty, 0x00, sizeof(g->dirty));
+
+  if (0 == g->onecolor && VIDEO_GENERATOR_PATTERN_BARS == g->pattern) {
+    g->bg = alloc_frame(g, g->nbytes);
+    if (!g->bg) {
+      log_error("Error: cannot allocate the background buffer.");
+      free_frame(g, g->y, g->nbytes);
+      g->y = NULL;
+      return -4;
+    }
+    memset(g->bg, 0x00, g->nbytes);
+    bg_planes[0] = g->bg;
+    bg_planes[1] = g->bg + g->ybytes;
+    bg_planes[2] = (1 == g->uv_interleaved) ? NULL : g->bg + g->ybytes + g->ubytes;
+    plane_strides(g, bg_strides);
+    band.y0 = 0;
+    band.y1 = g->height;
+    band.uv_y0 = 0;
+    band.uv_y1 = g->uv_height;
+    for (i = 0; i < 7; ++i) {
+      g->kernels->fill(g, bg_planes, bg_strides, &band, i * (g->width / 7), 0, (g->width / 7), g->height, &g->palette[i]);
+    }
+  }
+
+  /* the characters are decoded once per process, their offsets scale with the sample size. */
+  memcpy(g->chars, font_chars, sizeof(g->chars));
+  for (dx = 0; dx < RXS_MAX_CHARS; ++dx) {
+    g->chars[dx].offset *= g->pixel_size_in_bytes;
+  }
+  glyph_bytes = font_atlas_bytes * g->pixel_size_in_bytes;
+
+  /* bitmap font specifics */
+  g->font_w = RXS_FONT_W;
+  g->font_h = RXS_FONT_H;
+  g->font_line_height = 63;
+
+  /* 8-bit glyphs are used from the shared atlas, others are converted into samples once. */
+  uv_w = (0 == g->uv_width) ? 0 : (uint32_t)RXS_TEXT_W >> g->uv_shift_x;
+  uv_h = (0 == g->uv_width) ? 0 : (uint32_t)RXS_TEXT_H >> g->uv_shift_y;
+  g->glyphs = (1 == g->pixel_size_in_bytes) ? font_atlas : (uint8_t*)malloc(glyph_bytes);
+  g->text_box = (uint8_t*)malloc((RXS_TEXT_W * RXS_TEXT_H + 2 * uv_w * uv_h) * g->pixel_size_in_bytes);
+  g->text_box_key = 0;
+
+  /* one cycle of the bar positions, accumulated like `video_generator_update()` does so random access is bit exact. */
+  g->perc_cycle = 1;
+  for (perc = g->step; perc < 1.0; perc += g->step) {
+    g->perc_cycle++;
+  }
+  g->perc_table = (double*)malloc(g->perc_cycle * sizeof(double));
+
+  /* the x^2 term of the zone plate phase, for the y columns followed by the uv columns. */
+  g->zone_phase = NULL;
+  if (VIDEO_GENERATOR_PATTERN_ZONEPLATE == g->pattern) {
+    g->zone_phase = (uint16_t*)malloc((g->width + g->uv_width) * sizeof(uint16_t));
+  }
+
+  if (!g->glyphs || !g->text_box || !g->perc_table || (VIDEO_GENERATOR_PATTERN_ZONEPLATE == g->pattern && !g->zone_phase)) {
+    log_error("Error: cannot allocate the glyph atlas.");
+    if (font_atlas != g->glyphs) {
+      free(g->glyphs);
+    }
+    free(g->text_box);
+    free(g->perc_table);
+    free(g->zone_phase);
+    free_frame(g, g->bg, g->nbytes);
+    free_frame(g, g->y, g->nbytes);
+    g->glyphs = NULL;
+    g->text_box = NULL;
+    g->perc_table = NULL;
+    g->zone_phase = NULL;
+    g->bg = NULL;
+    g->y = NULL;
+    return -12;
+  }
+
+  perc = 0.0;
+  for (i = 0; i < g->perc_cycle; ++i) {
+    g->perc_table[i] = perc;
+    perc += g->step;
+  }
+
+  init_pattern(g);
+
+  if (font_atlas != g->glyphs) {
+    for (i = 0; i < font_atlas_bytes; ++i) {
+      sample = swizzle16((uint16_t)(font_atlas[i] * g->pixel_factor), g->byte_order);
+      memcpy(g->glyphs + i * 2, &sample, 2);
+    }
+  }
+
+  /* allocate the frame pool. */
+  g->pool = NULL;
+  g->pool_size = 0;
+
+  if (0 != cfg->pool_size) {
+
+    g->pool = (video_generator_frame*)calloc(cfg->pool_size, sizeof(video_generator_frame));
+    if (!g->pool) {
+      log_error("Error: cannot allocate the frame pool.");
+      goto pool_error;
+    }
+
+    for (i = 0; i < cfg->pool_size; ++i) {
+      g->pool[i].y = alloc_frame(g, g->nbytes);
+      if (!g->pool[i].y) {
+        log_error("Error: cannot allocate frame %u of the frame pool.", i);
+        goto pool_error;
+      }
+      g->pool[i].u = g->pool[i].y + g->ybytes;
+      g->pool[i].v = (1 == g->uv_interleaved) ? NULL : g->pool[i].u + g->ubytes;
+      g->pool_size++;
+    }
+
+    if (0 != mutex_init(&g->pool_mutex)) {
+      log_error("Error: cannot initialize the frame pool mutex!");
+      goto pool_error;
+    }
+  }
+
+  /* default audio settings. */
+  g->audio_bip_frequency = 0;
+  g->audio_bop_frequency = 0;
+  g->audio_nchannels = 0;
+  g->audio_samplerate = 0;
+  g->audio_format = VIDEO_GENERATOR_AUDIO_S16;
+  g->audio_frame_bytes = 0;
+  g->audio_nbytes = 0;
+  g->audio_buffer = NULL;
+  g->audio_callback = NULL;
+  g->audio_late_callback = NULL;
+  g->audio_realtime = 0;
+  g->audio_thread = NULL;
+  g->audio_thread_must_stop = 0;
+  g->context = NULL;
+  g->timer_next = NULL;
+  g->audio_pos = 0;
+  g->audio_chunk = 0;
+  g->audio_deadline = 0;
+  g->audio_prev_is_bip = 0;
+  g->audio_prev_is_bop = 0;
+  g->audio_is_bip = 0;
+  g->audio_is_bop = 0;
+  g->audio_mode = cfg->audio_mode;
+  g->audio_ring = NULL;
+  g->audio_ring_frames = 0;
+  g->audio_ring_write = 0;
+  g->audio_ring_read = 0;
+  g->audio_overruns = 0;
+  g->audio_underruns = 0;
+  g->workers = NULL;
+
+  /* initialize audio, from here on `video_generator_clear()` frees what was allocated. */
+  if (NULL != cfg->audio_callback || VIDEO_GENERATOR_AUDIO_CALLBACK != cfg->audio_mode) {
+
+    g->audio_bip_frequency = cfg->bip_frequency;
+    g->audio_bop_frequency = cfg->bop_frequency;
+    g->audio_bip_millis = 100;
+    g->audio_bop_millis = 100;
+    g->audio_nchannels = (0 == cfg->audio_nchannels) ? 2 : cfg->audio_nchannels;
+    g->audio_samplerate = (0 == cfg->audio_samplerate) ? 44100 : cfg->audio_samplerate;
+    g->audio_format = cfg->audio_format;
+    g->audio_nsamples = (0 == cfg->audio_nsamples) ? 1024 : cfg->audio_nsamples;
+    g->audio_nseconds = 4;
+    g->audio_callback = cfg->audio_callback;
+    g->audio_late_callback = cfg->audio_late_callback;
+    g->audio_realtime = (0 != cfg->audio_realtime) ? 1 : 0;
+
+    sample_bytes = (VIDEO_GENERATOR_AUDIO_S16 == g->audio_format) ? sizeof(int16_t) : sizeof(int32_t);
+    g->audio_frame_bytes = sample_bytes * g->audio_nchannels;
+
+    /* the samples are synthesized per chunk, offline mode delivers all the samples of a frame at once. */
+    period = g->audio_nsamples;
+    if (VIDEO_GENERATOR_AUDIO_OFFLINE == g->audio_mode) {
+      period = MAX(period, (g->audio_samplerate + cfg->fps - 1) / cfg->fps);
+    }
+    g->audio_nbytes = (size_t)period * g->audio_frame_bytes;
+    g->audio_buffer = (uint8_t*)malloc(g->audio_nbytes);
+    if (!g->audio_buffer) {
+      log_error("Error while allocating the audio buffer.");
+      video_generator_clear(g);
+      return -7;
+    }
+
+    /* in pull mode the audio thread writes into a ring of about 1.5 seconds, offline without a callback `update()` does. */
+    if (VIDEO_GENERATOR_AUDIO_PULL == g->audio_mode
+        || (VIDEO_GENERATOR_AUDIO_OFFLINE == g->audio_mode && NULL == g->audio_callback))
+    {
+      g->audio_ring_frames = RXS_AUDIO_RING_FRAMES;
+      while (g->audio_ring_frames < 4 * period) {
+        g->audio_ring_frames *= 2;
+      }
+      g->audio_ring = (uint8_t*)malloc((size_t)g->audio_ring_frames * g->audio_frame_bytes);
+      if (!g->audio_ring) {
+        log_error("Error: cannot allocate the audio ring.");
+        video_generator_clear(g);
+        return -13;
+      }
+    }
+
+    /* start audio thread, or let the timer of the context deliver the chunks; in offline mode the samples are generated by `update()`. */
+    g->audio_period = (uint64_t)(g->audio_nsamples * ((double)1.0/g->audio_samplerate) * 1e9);
+    if (VIDEO_GENERATOR_AUDIO_OFFLINE != g->audio_mode && NULL != cfg->context) {
+      context_join(cfg->context, g, 1);
+    }
+    else if (VIDEO_GENERATOR_AUDIO_OFFLINE != g->audio_mode) {
+      g->audio_thread = thread_alloc(audio_thread, (void*)g);
+    }
+    if (VIDEO_GENERATOR_AUDIO_OFFLINE != g->audio_mode && NULL == cfg->context && NULL == g->audio_thread) {
+      log_error("Error: cannot create audio thread.");
+      video_generator_clear(g);
+      return -9;
+    }
+  }
+
+  /* start the render threads, the calling thread renders a band too; a context shares its threads. */
+  g->nthreads = MIN(cfg->nthreads, RXS_MAX_THREADS);
+  if (NULL != cfg->context) {
+    if (NULL == g->context) {
+      context_join(cfg->context, g, 0);
+    }
+    g->workers = g->context->workers;
+    g->nthreads = g->context->nthreads;
+  }
+  else if (g->nthreads > 1) {
+    g->workers = workers_alloc(g->nthreads - 1);
+    if (NULL == g->workers) {
+      log_error("Error: cannot create the render threads.");
+      video_generator_clear(g);
+      return -10;
+    }
+    if (0 != (g->alloc_flags & VIDEO_GENERATOR_ALLOC_NUMA) && 0 != workers_bind(g->workers, g->numa_node)) {
+      log_error("Error: cannot run the render threads on numa node %u.", g->numa_node);
+      video_generator_clear(g);
+      return -10;
+    }
+  }
+
+  if (0 != cfg->cycle_cache && 0 != build_cycle(g)) {
+    log_error("Error: cannot allocate the cycle cache.");
+    video_generator_clear(g);
+    return -14;
+  }
+
+  return 0;
+
+ pool_error:
+  free_pool(g);
+  if (font_atlas != g->glyphs) {
+    free(g->glyphs);
+  }
+  free(g->text_box);
+  free(g->perc_table);
+  free(g->zone_phase);
+  g->glyphs = NULL;
+  g->text_box = NULL;
+  g->perc_table = NULL;
+  g->zone_phase = NULL;
+  free_frame(g, g->bg, g->nbytes);
+  g->bg = NULL;
+  free_frame(g, g->y, g->nbytes);
+  g->y = NULL;
+  return -5;
+}
+
+/*
+  Frame buffers start at a page boundary and span whole pages, so they
+  can be handed to the kernel (e.g. vmsplice() or O_DIRECT) as they are.
+  With huge pages or a numa node they are mapped by `map_frame()`, see
+  "Memory".
+*/
+static uint8_t* alloc_frame(video_generator* g, size_t nbytes) {
+  void* mem = NULL;
+  volatile uint8_t* page;
+  size_t i;
+  nbytes = frame_alloc_bytes(g, nbytes);
+  if (0 != (g->alloc_flags & (VIDEO_GENERATOR_ALLOC_HUGEPAGES | VIDEO_GENERATOR_ALLOC_NUMA))) {
+    mem = map_frame(g, nbytes);
+  }
+  else {
+#if defined(_WIN32)
+    mem = _aligned_malloc(nbytes, RXS_PAGE_SIZE);
+#else
+    if (0 != posix_memalign(&mem, RXS_PAGE_SIZE, nbytes)) {
+      mem = NULL;
+    }
+#endif
+  }
+  /* one write per page makes the kernel back all of them now, on the node of the policy. */
+  if (NULL != mem && 0 != (g->alloc_flags & VIDEO_GENERATOR_ALLOC_PREFAULT)) {
+    page = (volatile uint8_t*)mem;
+    for (i = 0; i < nbytes; i += RXS_PAGE_SIZE) {
+      page[i] = 0;
+    }
+  }
+  return (uint8_t*)mem;
+}
+
+static void free_frame(video_generator* g, uint8_t* frame, size_t nbytes) {
+  if (NULL == frame) {
+    return;
+  }
+  if (0 != (g->alloc_flags & (VIDEO_GENERATOR_ALLOC_HUGEPAGES | VIDEO_GENERATOR_ALLOC_NUMA))) {
+    unmap_frame(frame, frame_alloc_bytes(g, nbytes));
+    return;
+  }
+#if defined(_WIN32)
+  _aligned_free(frame);
+#else
+  free(frame);
+#endif
+}
+
+/* The size of a buffer of `nbytes`: whole pages, or whole huge pages when they're requested. */
+static size_t frame_alloc_bytes(video_generator* g, size_t nbytes) {
+  size_t align = (0 != (g->alloc_flags & VIDEO_GENERATOR_ALLOC_HUGEPAGES)) ? RXS_HUGE_PAGE_SIZE : RXS_PAGE_SIZE;
+  return (nbytes + align - 1) & ~(align - 1);
+}
+
+static void free_pool(video_generator* g) {
+  uint32_t i;
+
+  if (NULL == g->pool) {
+    return;
+  }
+
+  for (i = 0; i < g->pool_size; ++i) {
+    free_frame(g, g->pool[i].y, g->nbytes);
+  }
+
+  free(g->pool);
+  g->pool = NULL;
+  g->pool_size = 0;
+}
+
+int video_generator_clear(video_generator* g) {
+
+  if (!g) { return -1; }
+
+  /* stop the audio thread if it's running. */
+  if (NULL != g->audio_thread) {
+    ATOMIC_STORE8(&g->audio_thread_must_stop, 1);
+    thread_join(g->audio_thread);
+    thread_free(g->audio_thread);
+    g->audio_thread = NULL;
+  }
+
+  /* after this the timer of the context doesn't touch `g` anymore and the render threads aren't ours to free. */
+  if (NULL != g->context) {
+    context_leave(g);
+  }
+
+  /* free the audio buffers, offline mode doesn't have a thread. */
+  if (NULL != g->audio_buffer) {
+    free(g->audio_buffer);
+    g->audio_buffer = NULL;
+  }
+
+  free(g->audio_ring);
+  g->audio_ring = NULL;
+  g->audio_ring_frames = 0;
+  if (!g->width) { return -2; }
+  if (!g->height) { return -3; }
+
+  if (g->workers) {
+    workers_free(g->workers);
+  }
+  g->workers = NULL;
+
+  if (g->y) {
+    free_frame(g, g->y, g->nbytes);
+  }
+
+  if (g->bg) {
+    free_frame(g, g->bg, g->nbytes);
+  }
+
+  if (g->cycle) {
+    free_frame(g, g->cycle, (size_t)g->cycle_frames * g->nbytes);
+  }
+  g->cycle = NULL;
+  g->cycle_frames = 0;
+
+  if (font_atlas != g->glyphs) {
+    free(g->glyphs);
+  }
+  free(g->text_box);
+  free(g->perc_table);
+  free(g->zone_phase);
+  g->glyphs = NULL;
+  g->text_box = NULL;
+  g->perc_table = NULL;
+  g->zone_phase = NULL;
+  g->pattern = VIDEO_GENERATOR_PATTERN_BARS;
+  g->perc_cycle = 0;
+  g->text_box_key = 0;
+
+  if (g->pool) {
+    free_pool(g);
+    mutex_destroy(&g->pool_mutex);
+  }
+
+  g->y = NULL;
+  g->bg = NULL;
+  memset(&g->dirty, 0x00, sizeof(g->dirty));
+  g->u = NULL;
+  g->u = NULL;
+  g->width = 0;
+  g->height = 0;
+  g->frame = 0;
+  g->step = 0.0;
+  g->perc = 0.0;
+  g->fps = 0.0;
+  g->ybytes = 0;
+  g->ubytes = 0;
+  g->vbytes = 0;
+  g->nbytes = 0;
+  g->u_factor = 0.0;
+  g->v_factor = 0.0;
+  g->onecolor = 0;
+  g->format = 0;
+  g->bitdepth = 0;
+  g->stats_enabled = 0;
+
+  g->audio_nchannels = 0;
+  g->audio_nseconds = 0;
+  g->audio_samplerate = 0;
+  g->audio_format = VIDEO_GENERATOR_AUDIO_S16;
+  g->audio_frame_bytes = 0;
+  g->audio_bip_frequency = 0;
+  g->audio_bop_frequency = 0;
+  g->audio_bip_millis = 0;
+  g->audio_bop_millis = 0;
+  g->audio_nbytes = 0;
+  g->audio_callback = NULL;
+  g->audio_late_callback = NULL;
+  g->audio_realtime = 0;
+
+  return 0;
+}
+
+/* generates a new frame and stores it in the y, u and v members */
+int video_generator_update(video_generator* g) {
+
+  uint8_t* planes[3];
+  uint32_t strides[3];
+
+  if (!g) { return -1; }
+
+  if (NULL != g->cycle) {
+    memcpy(g->y, serve_cycle(g), g->nbytes);
+    return 0;
+  }
+
+  planes[0] = g->y;
+  planes[1] = g->u;
+  planes[2] = g->v;
+  plane_strides(g, strides);
+
+  return render(g, planes, strides, &g->dirty);
+}
+
+int video_generator_next_cached(video_generator* g, const uint8_t** frame) {
+
+  if (!g) { return -1; }
+  if (!frame) { return -2; }
+  if (NULL == g->cycle) { return -3; }
+
+  *frame = serve_cycle(g);
+
+  return 0;
+}
+
+/*
+  Renders the next frame into the caller's planes. Each plane may live
+  anywhere and have any alignment, `strides` are the number of bytes
+  between the start of two rows and must be at least the width of a
+  row. The generator doesn't know what is in your buffers (they're
+  often recycled by an encoder or a driver) so the complete frame is
+  drawn each time.
+*/
+int video_generator_update_into(video_generator* g, uint8_t* planes[3], uint32_t strides[3]) {
+
+  video_generator_dirty dirty;
+
+  if (!g) { return -1; }
+  if (!planes || !strides || !planes[0]) { return -2; }
+  if (strides[0] < g->width * g->pixel_size_in_bytes) { return -4; }
+  if (0 != g->uv_width) {
+    if (!planes[1]) { return -2; }
+    if (strides[1] < (g->uv_width * g->pixel_size_in_bytes) << g->uv_interleaved) { return -4; }
+  }
+  if (0 != g->uv_width && 0 == g->uv_interleaved) {
+    if (!planes[2]) { return -2; }
+    if (strides[2] < g->uv_width * g->pixel_size_in_bytes) { return -4; }
+  }
+
+  if (NULL != g->cycle) {
+    copy_frame(g, planes, strides, serve_cycle(g));
+    return 0;
+  }
+
+  memset(&dirty, 0x00, sizeof(dirty));
+
+  return render(g, planes, strides, &dirty);
+}
+
+int video_generator_acquire_frame(video_generator* g, video_generator_frame** frame) {
+
+  video_generator_frame* f = NULL;
+  uint8_t* planes[3];
+  uint32_t strides[3];
+  uint32_t i;
+  int r;
+
+  if (!g) { return -1; }
+  if (!frame) { return -2; }
+  if (!g->pool) { return -3; }
+
+  *frame = NULL;
+
+  mutex_lock(&g->pool_mutex);
+  {
+    for (i = 0; i < g->pool_size; ++i) {
+      if (0 == g->pool[i].in_use) {
+        f = &g->pool[i];
+        f->in_use = 1;
+        break;
+      }
+    }
+  }
+  mutex_unlock(&g->pool_mutex);
+
+  if (!f) {
+    return -4;
+  }
+
+  f->frame = g->frame;
+
+  planes[0] = f->y;
+  planes[1] = f->u;
+  planes[2] = f->v;
+  plane_strides(g, strides);
+  if (NULL != g->cycle) {
+    memcpy(f->y, serve_cycle(g), g->nbytes);
+    *frame = f;
+    return 0;
+  }
+  r = render(g, planes, strides, &f->dirty);
+  if (0 != r) {
+    video_generator_release_frame(g, f);
+    return r;
+  }
+
+  *frame = f;
+
+  return 0;
+}
+
+int video_generator_release_frame(video_generator* g, video_generator_frame* frame) {
+
+  if (!g) { return -1; }
+  if (!frame) { return -2; }
+  if (!g->pool || frame < g->pool || frame >= g->pool + g->pool_size) { return -3; }
+
+  mutex_lock(&g->pool_mutex);
+    frame->in_use = 0;
+  mutex_unlock(&g->pool_mutex);
+
+  return 0;
+}
+
+/*
+  Renders the next `n` frames into `frames`. A NULL entry gets a
+  buffer of the pool, like `video_generator_acquire_frame()`, which
+  you release when you're done with it; the other entries are your own
+  buffers with the layout of `y`, `u` and `v` and a zeroed `dirty` the
+  first time you pass them. The entries must be different buffers.
+
+  The frames are prepared one after the other and then drawn together
+  so the arguments are checked once and the render threads get the
+  bands of up to RXS_MAX_BATCH frames at once; a batch is cut short
+  when the cached text box changes, because the frames that are
+  waiting to be drawn still need the old one. All frame ids of a call
+  share one time stamp. With `stats` each frame is drawn by itself so
+  it gets its own timings.
+*/
+int video_generator_update_n(video_generator* g, uint32_t n, video_generator_frame** frames) {
+
+  video_generator_frame* f;
+  render_timeline timeline;
+  render_batch batch;
+  uint8_t* planes[3];
+  uint32_t strides[3];
+  uint32_t i, k, nfree, njobs;
+  uint8_t flush;
+
+  if (!g) { return -1; }
+  if (!frames) { return -2; }
+  if (!g->width || !g->height) { return -3; }
+
+  nfree = 0;
+  for (i = 0; i < n; ++i) {
+    if (NULL == frames[i]) {
+      nfree++;
+    }
+    else if (!frames[i]->y || (0 != g->uv_width && (!frames[i]->u || (0 == g->uv_interleaved && !frames[i]->v)))) {
+      return -2;
+    }
+  }
+
+  /* take all pool buffers at once, or none. */
+  if (0 != nfree) {
+    if (!g->pool) { return -3; }
+    mutex_lock(&g->pool_mutex);
+    {
+      for (i = 0, k = 0; i < g->pool_size && k < nfree; ++i) {
+        k += (0 == g->pool[i].in_use) ? 1 : 0;
+      }
+      if (k == nfree) {
+        for (i = 0, k = 0; k < n; ++k) {
+          if (NULL != frames[k]) {
+            continue;
+          }
+          while (0 != g->pool[i].in_use) {
+            i++;
+          }
+          g->pool[i].in_use = RXS_POOL_RESERVED;
+          frames[k] = &g->pool[i];
+        }
+        nfree = 0;
+      }
+    }
+    mutex_unlock(&g->pool_mutex);
+    if (0 != nfree) {
+      return -4;
+    }
+  }
+
+  plane_strides(g, strides);
+
+  if (NULL != g->cycle) {
+    for (i = 0; i < n; ++i) {
+      f = frames[i];
+      f->frame = g->frame;
+      planes[0] = f->y;
+      planes[1] = f->u;
+      planes[2] = f->v;
+      copy_frame(g, planes, strides, serve_cycle(g));
+    }
+    settle_pool(g, n, frames, 1);
+    return 0;
+  }
+
+  timeline.now = ns();
+  batch.nbands = 0;
+  njobs = 0;
+
+  for (i = 0; i <= n; ++i) {
+
+    if (i < n) {
+
+      /* in offline mode the audio of this frame is generated first, it also sets the bip/bop flags. */
+      if (VIDEO_GENERATOR_AUDIO_OFFLINE == g->audio_mode && NULL != g->audio_buffer) {
+        offline_audio(g);
+      }
+
+      timeline.is_bip = 0;
+      timeline.is_bop = 0;
+      if (NULL != g->audio_buffer) {
+        timeline.is_bop = ATOMIC_LOAD8(&g->audio_is_bop);
+        timeline.is_bip = ATOMIC_LOAD8(&g->audio_is_bip);
+      }
+    }
+
+    /* draw the queued frames when the batch is full or before the next frame changes the text box they still need. */
+    flush = (i == n || RXS_MAX_BATCH == njobs || 1 == g->stats_enabled) ? 1 : 0;
+    if (0 == flush && 0 == g->onecolor && 0 != g->text_box_key) {
+      flush = (g->text_box_key != text_box_key(g, text_color_index(timeline.is_bip, timeline.is_bop))) ? 1 : 0;
+    }
+
+    if (0 != njobs && 0 != flush) {
+      flush_batch(g, &batch, njobs);
+      njobs = 0;
+    }
+
+    if (i == n) {
+      break;
+    }
+
+    f = frames[i];
+    f->frame = g->frame;
+    planes[0] = f->y;
+    planes[1] = f->u;
+    planes[2] = f->v;
+    batch.start[njobs] = stats_frame_start(g);
+    if (0 != prepare_frame(g, planes, strides, &f->dirty, &timeline, &batch.jobs[njobs])) {
+      /* the prepared frames are drawn so their buffers match `dirty`, the generator stays at the failed frame. */
+      if (0 != njobs) {
+        flush_batch(g, &batch, njobs);
+      }
+      settle_pool(g, n, frames, 0);
+      return -5;
+    }
+    njobs++;
+  }
+
+  settle_pool(g, n, frames, 1);
+
+  return 0;
+}
+
+/* Draws the `njobs` prepared frames of `batch` together. */
+static void flush_batch(video_generator* g, render_batch* batch, uint32_t njobs) {
+
+  uint32_t k;
+
+  for (k = 0; k < njobs; ++k) {
+    batch->jobs[k].max_bands = (NULL == g->workers) ? 1 : MAX(1, g->nthreads / njobs);
+    batch_add(batch, k);
+  }
+
+  draw_batch(g->workers, batch);
+
+  for (k = 0; k < njobs; ++k) {
+    finish_frame(g, &batch->jobs[k], batch->start[k]);
+  }
+}
+
+/*
+  Hands the pool buffers that `video_generator_update_n()` reserved to
+  the caller, or with `keep` 0 puts them back into the pool and resets
+  their entries of `frames` to NULL.
+*/
+static void settle_pool(video_generator* g, uint32_t n, video_generator_frame** frames, uint8_t keep) {
+
+  uint32_t k;
+
+  if (!g->pool) {
+    return;
+  }
+
+  mutex_lock(&g->pool_mutex);
+  {
+    for (k = 0; k < n; ++k) {
+      if (frames[k] < g->pool || frames[k] >= g->pool + g->pool_size || RXS_POOL_RESERVED != frames[k]->in_use) {
+        continue;
+      }
+      if (1 == keep) {
+        frames[k]->in_use = 1;
+      }
+      else {
+        frames[k]->in_use = 0;
+        frames[k] = NULL;
+      }
+    }
+  }
+  mutex_unlock(&g->pool_mutex);
+}
+
+static int render(video_generator* g, uint8_t* const* planes, const uint32_t* strides, video_generator_dirty* dirty) {
+
+  uint64_t start;
+  uint8_t dx;
+  render_job job;
+
+  if (!g->width) { return -2; }
+  if (!g->height) { return -3; }
+
+  start = stats_frame_start(g);
+
+  /* in offline mode the audio of this frame is generated first, it also sets the bip/bop flags. */
+  if (VIDEO_GENERATOR_AUDIO_OFFLINE == g->audio_mode && NULL != g->audio_buffer) {
+    offline_audio(g);
+  }
+
+  if (0 != prepare_frame(g, planes, strides, dirty, NULL, &job)) {
+    return -1;
+  }
+
+  job.max_bands = (NULL == g->workers) ? 1 : g->nthreads;
+  split_bands(g, &job);
+
+  if (NULL != g->workers && job.nbands > 1) {
+    workers_run(g->workers, job.nbands, draw_band, &job);
+  }
+  else {
+    for (dx = 0; dx < job.nbands; ++dx) {
+      draw_band(&job, dx);
+    }
+  }
+
+  finish_frame(g, &job, start);
+
+  return 0;
+}
+
+/* Clears the stage times of the frame that is about to be rendered and returns when it started, 0 without `stats`. */
+static uint64_t stats_frame_start(video_generator* g) {
+
+  if (0 == g->stats_enabled) {
+    return 0;
+  }
+
+  memset(g->frame_stage_ns, 0x00, sizeof(g->frame_stage_ns));
+
+  return ns();
+}
+
+/*
+  Advances the bar and fills `job` with everything that has to be
+  drawn for the next frame, the drawing itself is done per band by
+  `draw_band()`. The bip/bop flags and the time of the frame id come
+  from `g` unless a `timeline` is given, which is how
+  `video_generator_multi_update()` keeps all renditions identical.
+  The drawing doesn't depend on the frame number so the generator is
+  advanced to the next frame right away, which lets
+  `video_generator_update_n()` prepare several frames before it draws
+  them.
+*/
+static int prepare_frame(video_generator* g, uint8_t* const* planes, const uint32_t* strides, video_generator_dirty* dirty, const render_timeline* timeline, render_job* job) {
+
+  uint8_t is_bip, is_bop;
+  uint32_t text_color, key, end_y, uv_start_y;
+  uint64_t t;
+  double perc;
+
+  memset(job, 0x00, sizeof(*job));
+  job->g = g;
+  job->timed = g->stats_enabled;
+  job->planes[0] = planes[0];
+  job->planes[1] = planes[1];
+  job->planes[2] = planes[2];
+  job->strides[0] = strides[0];
+  job->strides[1] = strides[1];
+  job->strides[2] = strides[2];
+
+  /* increment step */
+  perc = g->perc;
+  g->perc = next_perc(g);
+
+  /* The moving bar; on failure nothing of the generator has changed. */
+  if (0 != layout_bar(g, perc, g->perc, job)) {
+    g->perc = perc;
+    return -1;
+  }
+
+  /* the frame id is drawn on top of everything, in every band. */
+  if (1 == g->frame_id) {
+    job->with_id = 1;
+    make_frame_id(g->frame, (NULL != timeline) ? timeline->now : ns(), job->id);
+  }
+
+  if(g->onecolor)
+  {
+    /* the fill covers the complete frame so there is nothing to reset. */
+    job->onecolor = 1;
+    job->color = g->palette[g->frame % 7];
+    g->frame++;
+    return 0;
+  }
+
+  if (VIDEO_GENERATOR_PATTERN_BARS != g->pattern) {
+    /* the pattern covers the complete frame, there is no background to restore. */
+    set_pattern(g, g->frame, job);
+  }
+  else {
+    /* the rows of the chroma planes that are covered by the moving bar. */
+    uv_start_y = job->bar_y >> g->uv_shift_y;
+    end_y = uv_start_y + (job->bar_h >> g->uv_shift_y);
+
+    /* Restore the background */
+    if (0 == dirty->restored) {
+      job->full_restore = 1;
+      dirty->restored = 1;
+    }
+    else {
+      /* only the rows of the previous bar that the new bar doesn't cover; the
+         text box has a fixed position and is completely repainted below. */
+      job->restore[0][0] = dirty->y;
+      job->restore[0][1] = MIN(dirty->y + dirty->h, job->bar_y);
+      job->restore[1][0] = MAX(dirty->y, job->bar_y + job->bar_h);
+      job->restore[1][1] = dirty->y + dirty->h;
+      job->uv_restore[0][0] = dirty->uv_y;
+      job->uv_restore[0][1] = MIN(dirty->uv_y + dirty->uv_h, uv_start_y);
+      job->uv_restore[1][0] = MAX(dirty->uv_y, end_y);
+      job->uv_restore[1][1] = dirty->uv_y + dirty->uv_h;
+    }
+
+    dirty->y = job->bar_y;
+    dirty->h = job->bar_h;
+    dirty->uv_y = uv_start_y;
+    dirty->uv_h = end_y - uv_start_y;
+  }
+
+  /* draw blip/blop visuals. */
+  is_bip = 0;
+  is_bop = 0;
+  if (NULL != timeline) {
+    is_bip = timeline->is_bip;
+    is_bop = timeline->is_bop;
+  }
+  else if (NULL != g->audio_buffer) {
+    is_bop = ATOMIC_LOAD8(&g->audio_is_bop);
+    is_bip = ATOMIC_LOAD8(&g->audio_is_bip);
+  }
+  text_color = text_color_index(is_bip, is_bop);
+
+  /* The text box with time stamps */
+  if (0 == g->no_timestamp && g->width > RXS_TEXT_W && g->height > RXS_TEXT_H) {
+    job->with_text = 1;
+    job->text_x = (g->width / 2) - (RXS_TEXT_W / 2);
+    job->text_y = (g->height / 2) - (RXS_TEXT_H / 2);
+
+    /* the box only changes once per second or when the color changes. */
+    key = text_box_key(g, text_color);
+    if (key != g->text_box_key) {
+      t = (1 == job->timed) ? ns() : 0;
+      update_text_box(g, g->frame, text_color);
+      stage_done(job, VIDEO_GENERATOR_STAGE_GLYPHS, &t);
+      g->text_box_key = key;
+    }
+  }
+
+  g->frame++;
+
+  return 0;
+}
+
+/* Called when all bands of `job` are drawn. */
+static void finish_frame(video_generator* g, render_job* job, uint64_t start) {
+
+  if (1 == job->timed) {
+    stats_frame_done(g, start);
+  }
+}
+
+/* The cached text box only changes once per second or when the color changes; 0 means nothing is cached. */
+static uint32_t text_box_key(video_generator* g, uint32_t text_color) {
+  return ((uint32_t)((g->frame / g->fps_den) % 3600) * RXS_MAX_COLORS + text_color) + 1;
+}
+
+/* Splits job `index` of `b` into bands and queues them for `draw_batch()`. */
+static void batch_add(render_batch* b, uint32_t index) {
+
+  render_job* job = &b->jobs[index];
+  uint32_t i;
+
+  split_bands(job->g, job);
+
+  for (i = 0; i < job->nbands; ++i) {
+    b->job_of[b->nbands] = (uint8_t)index;
+    b->band_of[b->nbands] = (uint8_t)i;
+    b->nbands++;
+  }
+}
+
+/* Draws the queued bands of all jobs, on the render threads of `w` when given. */
+static void draw_batch(video_generator_workers* w, render_batch* b) {
+
+  uint32_t i;
+
+  if (NULL != w && b->nbands > 1) {
+    workers_run(w, b->nbands, draw_batch_band, b);
+  }
+  else {
+    for (i = 0; i < b->nbands; ++i) {
+      draw_batch_band(b, i);
+    }
+  }
+
+  b->nbands = 0;
+}
+
+static void draw_batch_band(void* user, uint32_t index) {
+
+  render_batch* b = (render_batch*)user;
+
+  draw_band(&b->jobs[b->job_of[index]], b->band_of[index]);
+}
+
+/*
+  Renders frame `frame` into `planes` without using or changing any
+  state of the generator: the bar position comes from the table that
+  `video_generator_init()` filled, the time stamp and the bip/bop
+  colors are derived from the frame number. The complete frame is drawn
+  on the calling thread, so this may be called from several threads at
+  once.
+*/
+int video_generator_render_frame(video_generator* g, uint64_t frame, uint8_t* planes[3]) {
+
+  uint8_t is_bip = 0;
+  uint8_t is_bop = 0;
+  uint32_t strides[3];
+  render_band band;
+  render_job job;
+
+  if (!g) { return -1; }
+  if (!planes || !planes[0]) { return -2; }
+  if (!g->perc_table) { return -3; }
+  if (0 != g->uv_width && (!planes[1] || (0 == g->uv_interleaved && !planes[2]))) { return -2; }
+
+  if (NULL != g->cycle) {
+    plane_strides(g, strides);
+    copy_frame(g, planes, strides, g->cycle + (size_t)(frame % g->cycle_frames) * g->nbytes);
+    return 0;
+  }
+
+  memset(&job, 0x00, sizeof(job));
+  job.g = g;
+  job.planes[0] = planes[0];
+  job.planes[1] = planes[1];
+  job.planes[2] = planes[2];
+  plane_strides(g, job.strides);
+
+  if (0 != layout_bar(g, g->perc_table[frame % g->perc_cycle], g->perc_table[(frame + 1) % g->perc_cycle], &job)) {
+    return -4;
+  }
+
+  if (g->onecolor) {
+    job.onecolor = 1;
+    job.color = g->palette[frame % 7];
+  }
+  else if (VIDEO_GENERATOR_PATTERN_BARS != g->pattern) {
+    set_pattern(g, frame, &job);
+  }
+  else {
+    job.full_restore = 1;
+  }
+
+  job.nbands = 1;
+  job.band[0] = 0;
+  job.band[1] = g->height;
+  draw_band(&job, 0);
+
+  band.y0 = 0;
+  band.y1 = g->height;
+  band.uv_y0 = 0;
+  band.uv_y1 = g->height >> g->uv_shift_y;
+
+  /* the cached text box belongs to `video_generator_update()` so we composite straight into the frame. */
+  if (0 == g->onecolor && 0 == g->no_timestamp && g->width > RXS_TEXT_W && g->height > RXS_TEXT_H) {
+    if (NULL != g->audio_buffer) {
+      frame_bip_bop(g, frame, &is_bip, &is_bop);
+    }
+    compose_text_box(g, planes, job.strides, (g->width / 2) - (RXS_TEXT_W / 2), (g->height / 2) - (RXS_TEXT_H / 2),
+                     frame, text_color_index(is_bip, is_bop));
+  }
+
+  /* after the text box, which it overlaps in small frames. */
+  if (1 == g->frame_id) {
+    make_frame_id(frame, ns(), job.id);
+    draw_frame_id(&job, &band);
+  }
+
+  return 0;
+}
+
+/*
+  Computes the rows and the color of the moving bar. The bar is drawn
+  at `perc` and, like it always did, uses the color of the position of
+  the next frame, `next`.
+*/
+/* The position of the bar in the frame after the current one. */
+static double next_perc(video_generator* g) {
+  double next = g->perc + g->step;
+  return (next >= 1.0) ? 0.0 : next;
+}
+
+static int layout_bar(video_generator* g, double perc, double next, render_job* job) {
+
+  int32_t bar_h, start_y, nlines, h;
+  uint8_t rc, gc, bc;
+
+  h = (int32_t)(g->height - 1);
+  bar_h = (int32_t)(g->height / 5);
+  start_y = -bar_h +  (int32_t)(perc * (h + bar_h));
+
+  /* how many lines of the bar are visible */
+  if (start_y < 0) {
+    nlines = bar_h + start_y;
+    start_y = 0;
+  }
+  else if(start_y + bar_h > h) {
+    nlines = h - start_y;
+  }
+  else {
+    nlines = bar_h;
+  }
+
+  if (nlines + start_y >  (int32_t)g->height || nlines < 0 || start_y < 0 || start_y >=  (int32_t)g->height) {
+    log_error("Error: this shouldn't happen.. writing outside the buffer: %d, %d, %d", nlines, (nlines + start_y), start_y);
+    return -1;
+  }
+
+  rc = (uint8_t)(255 - (uint8_t)(next * 255));
+  gc = (uint8_t)(30 + (uint8_t)(next * 235));
+  bc = (uint8_t)(150 + (uint8_t)(next * 205));
+  job->bar_y = (uint32_t)start_y;
+  job->bar_h = (uint32_t)nlines;
+  make_color(g, rc, gc, bc, &job->bar_color);
+
+  return 0;
+}
+
+/* Whether the audio samples of `frame` contain the bip or the bop, see `offline_audio()`. */
+static void frame_bip_bop(video_generator* g, uint64_t frame, uint8_t* is_bip, uint8_t* is_bop) {
+
+  uint64_t start = (frame * g->audio_samplerate) / g->fps_den;
+  uint64_t end = ((frame + 1) * g->audio_samplerate) / g->fps_den;
+
+  range_bip_bop(g, start, end - start, is_bip, is_bop);
+}
+
+/* Whether the samples [start, start + nframes) overlap the bip or the bop. */
+static void range_bip_bop(video_generator* g, uint64_t start, uint64_t nframes, uint8_t* is_bip, uint8_t* is_bop) {
+
+  uint64_t loop = (uint64_t)g->audio_samplerate * g->audio_nseconds;
+  uint64_t pos = start % loop;
+  uint64_t bip_start, bip_end, bop_start, bop_end;
+
+  tone_window(g, 0, &bip_start, &bip_end);
+  tone_window(g, 1, &bop_start, &bop_end);
+
+  *is_bip = (pos < bip_end && pos + nframes > bip_start) ? 1 : 0;
+  *is_bop = (pos < bop_end && pos + nframes > bop_start) ? 1 : 0;
+}
+
+/* The samples [start, end) of the loop that play the bip (tone 0) at 1 second or the bop (tone 1) at 3 seconds. */
+static void tone_window(video_generator* g, uint32_t tone, uint64_t* start, uint64_t* end) {
+
+  if (0 == tone) {
+    *start = g->audio_samplerate;
+    *end = *start + ((uint64_t)g->audio_bip_millis * g->audio_samplerate) / 1000;
+  }
+  else {
+    *start = (uint64_t)g->audio_samplerate * 3;
+    *end = *start + ((uint64_t)g->audio_bop_millis * g->audio_samplerate) / 1000;
+  }
+}
+
+static uint32_t text_color_index(uint8_t is_bip, uint8_t is_bop) {
+  if (1 == is_bop) { return RXS_COLOR_BOP; }
+  if (1 == is_bip) { return RXS_COLOR_BIP; }
+  return RXS_COLOR_TEXT;
+}
+
+/*
+  Renders the frames of one cycle into the cache: the 7 colors of
+  `onecolor` or one sweep of the bar. Because the content repeats,
+  frame n of the output is frame n % cycle_frames of the cache.
+*/
+static int build_cycle(video_generator* g) {
+
+  uint32_t n = (1 == g->onecolor) ? 7 : g->perc_cycle;
+  uint8_t* cycle;
+  uint8_t* planes[3];
+  uint32_t i;
+
+  cycle = alloc_frame(g, (size_t)n * g->nbytes);
+  if (NULL == cycle) {
+    return -1;
+  }
+
+  for (i = 0; i < n; ++i) {
+    planes[0] = cycle + (size_t)i * g->nbytes;
+    planes[1] = planes[0] + g->ybytes;
+    planes[2] = (1 == g->uv_interleaved) ? NULL : planes[1] + g->ubytes;
+    if (0 != video_generator_render_frame(g, i, planes)) {
+      free_frame(g, cycle, (size_t)n * g->nbytes);
+      return -2;
+    }
+  }
+
+  g->cycle = cycle;
+  g->cycle_frames = n;
+
+  return 0;
+}
+
+/* Advances the generator by one frame like `render()` does and returns the cached frame. */
+static const uint8_t* serve_cycle(video_generator* g) {
+
+  const uint8_t* src = g->cycle + (size_t)(g->frame % g->cycle_frames) * g->nbytes;
+  uint64_t start = 0;
+
+  if (1 == g->stats_enabled) {
+    start = ns();
+    memset(g->frame_stage_ns, 0x00, sizeof(g->frame_stage_ns));
+  }
+
+  if (VIDEO_GENERATOR_AUDIO_OFFLINE == g->audio_mode && NULL != g->audio_buffer) {
+    offline_audio(g);
+  }
+
+  g->perc += g->step;
+  if (g->perc >= (1.0)) {
+    g->perc = 0.0;
+  }
+
+  if (1 == g->stats_enabled) {
+    stats_frame_done(g, start);
+  }
+
+  g->frame++;
+
+  return src;
+}
+
+/*
+  Divides the rows that need work into bands of about the same size so
+  each render thread gets a similar amount of work. The bands together
+  cover the complete frame; a band only draws into the rows it owns.
+*/
+static void split_bands(video_generator* g, render_job* job) {
+
+  uint32_t from[3], to[3];
+  uint32_t nranges = 0;
+  uint32_t total = 0;
+  uint32_t nbands, i, r, want, seen;
+
+  if (job->onecolor || job->full_restore || job->pattern) {
+    from[nranges] = 0;
+    to[nranges++] = g->height;
+  }
+  else {
+    for (i = 0; i < 2; ++i) {
+      if (job->restore[i][0] < job->restore[i][1]) {
+        from[nranges] = job->restore[i][0];
+        to[nranges++] = job->restore[i][1];
+      }
+    }
+    if (0 != job->bar_h) {
+      from[nranges] = job->bar_y;
+      to[nranges++] = job->bar_y + job->bar_h;
+    }
+  }
+
+  for (i = 0; i < nranges; ++i) {
+    total += to[i] - from[i];
+  }
+
+  nbands = MAX(1, job->max_bands);
+  nbands = MIN(nbands, MAX(1, total / RXS_MIN_BAND_ROWS));
+
+  job->nbands = nbands;
+  job->band[0] = 0;
+  job->band[nbands] = g->height;
+
+  /* sort the (non overlapping) ranges from top to bottom. */
+  for (i = 1; i < nranges; ++i) {
+    for (r = i; r > 0 && from[r] < from[r - 1]; --r) {
+      seen = from[r]; from[r] = from[r - 1]; from[r - 1] = seen;
+      seen = to[r]; to[r] = to[r - 1]; to[r - 1] = seen;
+    }
+  }
+
+  /* each band starts at the row that has `want` rows of work above it. */
+  r = 0;
+  seen = 0;
+  for (i = 1; i < nbands; ++i) {
+    want = (uint32_t)(((uint64_t)total * i) / nbands);
+    while (want >= seen + (to[r] - from[r])) {
+      seen += to[r] - from[r];
+      r++;
+    }
+    job->band[i] = from[r] + (want - seen);
+  }
+}
+
+static void draw_band(void* user, uint32_t index) {
+
+  render_job* job = (render_job*)user;
+  video_generator* g = job->g;
+  uint8_t* py = job->planes[0];
+  uint8_t* pu = job->planes[1];
+  uint8_t* pv = job->planes[2];
+  render_band band;
+  uint32_t bg_strides[3];
+  uint32_t i, uv_w, uv_h, pss;
+  uint32_t* strides = job->strides;
+  uint8_t* bg_u;
+  uint8_t* bg_v;
+  uint64_t t = (1 == job->timed) ? ns() : 0;
+
+  band.y0 = job->band[index];
+  band.y1 = job->band[index + 1];
+  band.uv_y0 = band.y0 >> g->uv_shift_y;
+  band.uv_y1 = band.y1 >> g->uv_shift_y;
+
+  if (job->onecolor) {
+    g->kernels->fill(g, job->planes, strides, &band, 0, 0, g->width, g->height, &job->color);
+    stage_done(job, VIDEO_GENERATOR_STAGE_BACKGROUND, &t);
+    if (job->with_id) {
+      draw_frame_id(job, &band);
+      stage_done(job, VIDEO_GENERATOR_STAGE_TEXT, &t);
+    }
+    return;
+  }
+
+  if (job->pattern) {
+    draw_pattern(job, &band);
+    stage_done(job, VIDEO_GENERATOR_STAGE_BACKGROUND, &t);
+  }
+  else {
+    /* the v rows of the semi-planar formats are part of the uv rows, their stride is 0 so they are skipped. */
+    plane_strides(g, bg_strides);
+    bg_u = g->bg + g->ybytes;
+    bg_v = g->bg + g->ybytes + g->ubytes;
+
+    /* Restore the background */
+    if (job->full_restore) {
+      restore_rows(py, strides[0], g->bg, bg_strides[0], band.y0, band.y1);
+      restore_rows(pu, strides[1], bg_u, bg_strides[1], band.uv_y0, band.uv_y1);
+      restore_rows(pv, strides[2], bg_v, bg_strides[2], band.uv_y0, band.uv_y1);
+    }
+    else {
+      for (i = 0; i < 2; ++i) {
+        restore_rows(py, strides[0], g->bg, bg_strides[0], MAX(job->restore[i][0], band.y0), MIN(job->restore[i][1], band.y1));
+        restore_rows(pu, strides[1], bg_u, bg_strides[1], MAX(job->uv_restore[i][0], band.uv_y0), MIN(job->uv_restore[i][1], band.uv_y1));
+        restore_rows(pv, strides[2], bg_v, bg_strides[2], MAX(job->uv_restore[i][0], band.uv_y0), MIN(job->uv_restore[i][1], band.uv_y1));
+      }
+    }
+    stage_done(job, VIDEO_GENERATOR_STAGE_RESET, &t);
+
+    /* Draw the moving bar */
+    g->kernels->fill(g, job->planes, strides, &band, 0, job->bar_y, g->width, job->bar_h, &job->bar_color);
+    stage_done(job, VIDEO_GENERATOR_STAGE_BAR, &t);
+  }
+
+  /* Draw the text box with time stamps */
+  if (job->with_text) {
+    pss = g->pixel_size_in_bytes;
+    copy_rect(py + job->text_x * pss, strides[0], g->text_box, RXS_TEXT_W * pss, job->text_y, RXS_TEXT_H, band.y0, band.y1);
+    if (0 != g->uv_width) {
+      uv_w = RXS_TEXT_W >> g->uv_shift_x;
+      uv_h = RXS_TEXT_H >> g->uv_shift_y;
+      copy_rect(pu + ((job->text_x >> g->uv_shift_x) * pss << g->uv_interleaved), strides[1], g->text_box + RXS_TEXT_W * RXS_TEXT_H * pss,
+                uv_w * pss << g->uv_interleaved, job->text_y >> g->uv_shift_y, uv_h, band.uv_y0, band.uv_y1);
+      if (0 == g->uv_interleaved) {
+        copy_rect(pv + (job->text_x >> g->uv_shift_x) * pss, strides[2], g->text_box + (RXS_TEXT_W * RXS_TEXT_H + uv_w * uv_h) * pss,
+                  uv_w * pss, job->text_y >> g->uv_shift_y, uv_h, band.uv_y0, band.uv_y1);
+      }
+    }
+    stage_done(job, VIDEO_GENERATOR_STAGE_TEXT, &t);
+  }
+
+  if (job->with_id) {
+    draw_frame_id(job, &band);
+    stage_done(job, VIDEO_GENERATOR_STAGE_TEXT, &t);
+  }
+}
+
+/* The frame id: `frame` and `timestamp` big endian followed by the CRC-16 of these 16 bytes. */
+static void make_frame_id(uint64_t frame, uint64_t timestamp, uint8_t* id) {
+
+  uint16_t crc;
+  uint32_t i;
+
+  for (i = 0; i < 8; ++i) {
+    id[i] = (uint8_t)(frame >> (56 - 8 * i));
+    id[8 + i] = (uint8_t)(timestamp >> (56 - 8 * i));
+  }
+
+  crc = crc16(id, 16);
+  id[16] = (uint8_t)(crc >> 8);
+  id[17] = (uint8_t)(crc & 0xff);
+}
+
+/* CRC-16/CCITT-FALSE, the id is only 16 bytes so we don't bother with a table. */
+static uint16_t crc16(const uint8_t* data, uint32_t nbytes) {
+
+  uint16_t crc = 0xffff;
+  uint32_t i, j;
+
+  for (i = 0; i < nbytes; ++i) {
+    crc ^= (uint16_t)(data[i] << 8);
+    for (j = 0; j < 8; ++j) {
+      crc = (uint16_t)((crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1));
+    }
+  }
+
+  return crc;
+}
+
+/* Draws the bits of `job->id` as blocks in the top left corner; blocks of the same value on a row are filled at once. */
+static void draw_frame_id(render_job* job, const render_band* band) {
+
+  video_generator* g = job->g;
+  uint32_t row, col, start, bit, value;
+
+  if (band->y0 >= RXS_ID_ROWS * RXS_ID_BLOCK) {
+    return;
+  }
+
+  for (row = 0; row < RXS_ID_ROWS; ++row) {
+    start = 0;
+    value = 0;
+    for (col = 0; col <= RXS_ID_COLS; ++col) {
+      bit = row * RXS_ID_COLS + col;
+      if (col < RXS_ID_COLS) {
+        bit = (job->id[bit >> 3] >> (7 - (bit & 7))) & 1;
+      }
+      if (0 == col) {
+        value = bit;
+        continue;
+      }
+      if (col < RXS_ID_COLS && bit == value) {
+        continue;
+      }
+      g->kernels->fill(g, job->planes, job->strides, band, start * RXS_ID_BLOCK, row * RXS_ID_BLOCK,
+                       (col - start) * RXS_ID_BLOCK, RXS_ID_BLOCK, &g->id_colors[value]);
+      start = col;
+      value = bit;
+    }
+  }
+}
+
+/*
+  Reads the frame id from the y-plane of a (decoded) frame. Each block
+  is measured by the average of its center 4 x 4 samples and compared
+  with the middle between the darkest and the brightest block, so the
+  level doesn't matter: limited or full range, or samples that are LSB
+  or MSB aligned. Returns -3 when there's no contrast and -4 when the
+  CRC doesn't match, e.g. when the frame was scaled or damaged.
+*/
+int video_generator_read_frame_id(const uint8_t* y, uint32_t stride, uint8_t bitdepth, uint8_t byte_order, uint64_t* frame, uint64_t* timestamp) {
+
+  uint32_t level[RXS_ID_COLS * RXS_ID_ROWS];
+  uint32_t lo = 0xffffffff;
+  uint32_t hi = 0;
+  uint32_t pss = (bitdepth > 8) ? 2 : 1;
+  uint32_t i, j, k, sx, sy, sum, mid;
+  uint8_t id[RXS_ID_BYTES];
+  const uint8_t* p;
+
+  if (!y) { return -1; }
+  if (!frame || !timestamp) { return -2; }
+
+  for (i = 0; i < RXS_ID_COLS * RXS_ID_ROWS; ++i) {
+    sx = (i % RXS_ID_COLS) * RXS_ID_BLOCK + RXS_ID_BLOCK / 4;
+    sy = (i / RXS_ID_COLS) * RXS_ID_BLOCK + RXS_ID_BLOCK / 4;
+    sum = 0;
+    for (j = 0; j < RXS_ID_BLOCK / 2; ++j) {
+      p = y + (size_t)(sy + j) * stride + sx * pss;
+      for (k = 0; k < RXS_ID_BLOCK / 2; ++k) {
+        if (1 == pss) {
+          sum += p[k];
+        }
+        else if (BYTE_ORDER_BIG_ENDIAN == byte_order) {
+          sum += (uint32_t)((p[2 * k] << 8) | p[2 * k + 1]);
+        }
+        else {
+          sum += (uint32_t)((p[2 * k + 1] << 8) | p[2 * k]);
+        }
+      }
+    }
+    level[i] = sum;
+    lo = MIN(lo, sum);
+    hi = MAX(hi, sum);
+  }
+
+  if (hi - lo < RXS_ID_BLOCK * RXS_ID_BLOCK / 4) {
+    return -3;
+  }
+
+  mid = lo + (hi - lo) / 2;
+  memset(id, 0x00, sizeof(id));
+  for (i = 0; i < RXS_ID_COLS * RXS_ID_ROWS; ++i) {
+    if (level[i] > mid) {
+      id[i >> 3] |= (uint8_t)(0x80 >> (i & 7));
+    }
+  }
+
+  if (crc16(id, 16) != (uint16_t)((id[16] << 8) | id[17])) {
+    return -4;
+  }
+
+  *frame = 0;
+  *timestamp = 0;
+  for (i = 0; i < 8; ++i) {
+    *frame = (*frame << 8) | id[i];
+    *timestamp = (*timestamp << 8) | id[8 + i];
+  }
+
+  return 0;
+}
+
+/* Adds the time since `*t` to `stage` of the frame that is rendered; the render threads do this at the same time. */
+static void stage_done(render_job* job, uint32_t stage, uint64_t* t) {
+
+  uint64_t now;
+
+  if (0 == job->timed) {
+    return;
+  }
+
+  now = ns();
+  ATOMIC_ADD64(&job->g->frame_stage_ns[stage], now - *t);
+  *t = now;
+}
+
+/* Called once all bands of a frame are drawn. */
+static void stats_frame_done(video_generator* g, uint64_t start) {
+
+  uint32_t i;
+
+  g->frame_stage_ns[VIDEO_GENERATOR_STAGE_FRAME] = ns() - start;
+
+  for (i = 0; i < VIDEO_GENERATOR_NUM_STAGES; ++i) {
+    g->stats.last_stage_ns[i] = g->frame_stage_ns[i];
+    g->stats.stage_ns[i] += g->frame_stage_ns[i];
+  }
+
+  g->stats.frames++;
+}
+
+/* Converts a RGB color into y, u and v samples in the output bitdepth and byte order. */
+static void make_color(video_generator* g, uint8_t r, uint8_t gc, uint8_t b, video_generator_color* out) {
+  out->y = (uint16_t)(RGB2Y(r, gc, b) * g->pixel_factor);
+  out->u = (uint16_t)(RGB2U(r, gc, b) * g->pixel_factor);
+  out->v = (uint16_t)(RGB2V(r, gc, b) * g->pixel_factor);
+  if (2 == g->pixel_size_in_bytes) {
+    out->y = swizzle16(out->y, g->byte_order);
+    out->u = swizzle16(out->u, g->byte_order);
+    out->v = swizzle16(out->v, g->byte_order);
+  }
+
+  /* the u/v pair as a pattern that `fill16` or `fill32` can store as is. */
+  if (1 == g->pixel_size_in_bytes) {
+    uint8_t bytes[2] = { (uint8_t)out->u, (uint8_t)out->v };
+    uint16_t pair;
+    memcpy(&pair, bytes, 2);
+    out->uv = pair;
+  }
+  else {
+    uint8_t bytes[4];
+    memcpy(bytes, &out->u, 2);
+    memcpy(bytes + 2, &out->v, 2);
+    memcpy(&out->uv, bytes, 4);
+  }
+}
+
+/*
+  The fill kernels, one for each sample size and chroma layout. All
+  geometry is known when they're compiled, the bitdepth and byte order
+  are already applied to the samples by `make_color()`.
+*/
+#define ROW_FILL_1(g, dst, sample, n) memset((dst), (uint8_t)(sample), (n))
+#define ROW_FILL_2(g, dst, sample, n) (g)->fill16((dst), (sample), (n))
+
+#define DEFINE_FILL_KERNEL(NAME, PS, HAS_UV, SX, SY)                                                        \
+  static void NAME(video_generator* g, uint8_t* const* planes, const uint32_t* strides,                     \
+                   const render_band* band, uint32_t x, uint32_t y, uint32_t w, uint32_t h, const video_generator_color* c) {        \
+    uint8_t* py = planes[0];                                                                                \
+    uint8_t* pu = planes[1];                                                                                \
+    uint8_t* pv = planes[2];                                                                                \
+    uint32_t j, end;                                                                                        \
+    (void)g;                                                                                                \
+    end = MIN(y + h, band->y1);                                                                             \
+    for (j = MAX(y, band->y0); j < end; ++j) {                                                              \
+      ROW_FILL_##PS(g, py + (size_t)j * strides[0] + x * PS, c->y, w);                                      \
+    }                                                                                                       \
+    if (HAS_UV) {                                                                                           \
+      end = MIN((y >> SY) + (h >> SY), band->uv_y1);                                                        \
+      for (j = MAX(y >> SY, band->uv_y0); j < end; ++j) {                                                   \
+        ROW_FILL_##PS(g, pu + (size_t)j * strides[1] + (x >> SX) * PS, c->u, w >> SX);                      \
+        ROW_FILL_##PS(g, pv + (size_t)j * strides[2] + (x >> SX) * PS, c->v, w >> SX);                      \
+      }                                                                                                     \
+    }                                                                                                       \
+  }
+
+/* The same for one interleaved uv-plane: each u/v pair is a single pattern so a chroma row is one fill. */
+#define ROW_FILL_UV_1(g, dst, pair, n) (g)->fill16((dst), (uint16_t)(pair), (n))
+#define ROW_FILL_UV_2(g, dst, pair, n) (g)->fill32((dst), (pair), (n))
+
+#define DEFINE_FILL_KERNEL_UV(NAME, PS, SX, SY)                                                             \
+  static void NAME(video_generator* g, uint8_t* const* planes, const uint32_t* strides,                     \
+                   const render_band* band, uint32_t x, uint32_t y, uint32_t w, uint32_t h, const video_generator_color* c) { \
+    uint8_t* py = planes[0];                                                                                \
+    uint8_t* puv = planes[1];                                                                               \
+    uint32_t j, end;                                                                                        \
+    end = MIN(y + h, band->y1);                                                                             \
+    for (j = MAX(y, band->y0); j < end; ++j) {                                                              \
+      ROW_FILL_##PS(g, py + (size_t)j * strides[0] + x * PS, c->y, w);                                      \
+    }                                                                                                       \
+    end = MIN((y >> SY) + (h >> SY), band->uv_y1);                                                          \
+    for (j = MAX(y >> SY, band->uv_y0); j < end; ++j) {                                                     \
+      ROW_FILL_UV_##PS(g, puv + (size_t)j * strides[1] + (x >> SX) * 2 * PS, c->uv, w >> SX);               \
+    }                                                                                                       \
+  }
+
+DEFINE_FILL_KERNEL(fill_400_1, 1, 0, 0, 0)
+DEFINE_FILL_KERNEL(fill_420_1, 1, 1, 1, 1)
+DEFINE_FILL_KERNEL(fill_422_1, 1, 1, 1, 0)
+DEFINE_FILL_KERNEL(fill_444_1, 1, 1, 0, 0)
+DEFINE_FILL_KERNEL(fill_400_2, 2, 0, 0, 0)
+DEFINE_FILL_KERNEL(fill_420_2, 2, 1, 1, 1)
+DEFINE_FILL_KERNEL(fill_422_2, 2, 1, 1, 0)
+DEFINE_FILL_KERNEL(fill_444_2, 2, 1, 0, 0)
+DEFINE_FILL_KERNEL_UV(fill_nv12_1, 1, 1, 1)
+DEFINE_FILL_KERNEL_UV(fill_nv12_2, 2, 1, 1)
+
+static const video_generator_kernels kernels[2][5] = {
+  { { fill_400_1 }, { fill_420_1 }, { fill_422_1 }, { fill_444_1 }, { fill_nv12_1 } },
+  { { fill_400_2 }, { fill_420_2 }, { fill_422_2 }, { fill_444_2 }, { fill_nv12_2 } }
+};
+
+static void select_kernels(video_generator* g, uint32_t format) {
+  uint32_t layout;
+  switch (format) {
+    case 400: { layout = 0; break; }
+    case 422: { layout = 2; break; }
+    case 444: { layout = 3; break; }
+    case VIDEO_GENERATOR_FORMAT_NV12: { layout = 4; break; }
+    case 420:
+    default:  { layout = 1; break; }
+  }
+  g->kernels = &kernels[g->pixel_size_in_bytes - 1][layout];
+}
+
+/* Copies the rows [from, to) of the background `src` into `dst`, in one go when both have the same stride. */
+static void restore_rows(uint8_t* dst, uint32_t dst_stride, const uint8_t* src, uint32_t src_stride, uint32_t from, uint32_t to) {
+  uint32_t j;
+  if (from >= to || 0 == src_stride) { return; }
+  if (dst_stride == src_stride) {
+    memcpy(dst + (size_t)from * src_stride, src + (size_t)from * src_stride, (size_t)(to - from) * src_stride);
+    return;
+  }
+  for (j = from; j < to; ++j) {
+    memcpy(dst + (size_t)j * dst_stride, src + (size_t)j * src_stride, src_stride);
+  }
+}
+
+/* Copies a complete frame with packed rows, e.g. from the cycle cache, into `planes`. */
+static void copy_frame(video_generator* g, uint8_t* const* planes, const uint32_t* strides, const uint8_t* src) {
+
+  uint32_t packed[3];
+
+  plane_strides(g, packed);
+  restore_rows(planes[0], strides[0], src, packed[0], 0, g->height);
+  restore_rows(planes[1], strides[1], src + g->ybytes, packed[1], 0, g->uv_height);
+  restore_rows(planes[2], strides[2], src + g->ybytes + g->ubytes, packed[2], 0, g->uv_height);
+}
+
+/* The strides of the planes that the generator allocates: rows are packed without padding. */
+static void plane_strides(video_generator* g, uint32_t* strides) {
+  strides[0] = g->width * g->pixel_size_in_bytes;
+  strides[1] = (g->uv_width * g->pixel_size_in_bytes) << g->uv_interleaved;
+  strides[2] = (1 == g->uv_interleaved) ? 0 : strides[1];
+}
+
+/* Copies the rows [y, y + h) of a `src_stride` wide rectangle into `dst`, clipped to the rows [from, to). */
+static void copy_rect(uint8_t* dst, uint32_t dst_stride, const uint8_t* src, uint32_t src_stride, uint32_t y, uint32_t h, uint32_t from, uint32_t to) {
+  uint32_t j, end;
+  end = MIN(y + h, to);
+  for (j = MAX(y, from); j < end; ++j) {
+    memcpy(dst + (size_t)j * dst_stride, src + (size_t)(j - y) * src_stride, src_stride);
+  }
+}
+
+/*
+  Composites the text box with the `MM:SS` time stamp of `frame` at
+  luma position x, y. The glyphs are already converted into samples so
+  each glyph row is one memcpy. The characters `0-9` and `:` are stored
+  in that order, which means we can index `chars` directly.
+*/
+static void compose_text_box(video_generator* g, uint8_t* const* planes, const uint32_t* strides, uint32_t x, uint32_t y, uint64_t frame, uint32_t color) {
+
+  uint32_t pss = g->pixel_size_in_bytes;
+  uint64_t seconds = (frame / g->fps_den) % 60;
+  uint64_t minutes = (frame / g->fps_den / 60) % 60;
+  video_generator_char* kar;
+  render_band band;
+  char str[5];
+  uint32_t i, j, gx;
+
+  /* the box itself is a rectangle like the bars. */
+  band.y0 = y;
+  band.y1 = y + RXS_TEXT_H;
+  band.uv_y0 = y >> g->uv_shift_y;
+  band.uv_y1 = (y >> g->uv_shift_y) + (RXS_TEXT_H >> g->uv_shift_y);
+  g->kernels->fill(g, planes, strides, &band, x, y, RXS_TEXT_W, RXS_TEXT_H, &g->palette[color]);
+
+  str[0] = (char)('0' + minutes / 10);
+  str[1] = (char)('0' + minutes % 10);
+  str[2] = ':';
+  str[3] = (char)('0' + seconds / 10);
+  str[4] = (char)('0' + seconds % 10);
+
+  gx = x + RXS_TEXT_PAD;
+  for (i = 0; i < sizeof(str); ++i) {
+    kar = &g->chars[str[i] - '0'];
+    for (j = 0; j < kar->height; ++j) {
+      memcpy(planes[0] + (size_t)(y + RXS_TEXT_PAD + kar->yoffset + j) * strides[0] + gx * pss,
+             g->glyphs + kar->offset + j * kar->width * pss,
+             kar->width * pss);
+    }
+    gx += kar->xadvance;
+  }
+}
+
+/* Renders the text box into the `text_box` cache which `draw_band()` copies into each frame. */
+static void update_text_box(video_generator* g, uint64_t frame, uint32_t color) {
+
+  uint32_t pss = g->pixel_size_in_bytes;
+  uint32_t uv_w = (0 == g->uv_width) ? 0 : (uint32_t)RXS_TEXT_W >> g->uv_shift_x;
+  uint32_t uv_h = (0 == g->uv_width) ? 0 : (uint32_t)RXS_TEXT_H >> g->uv_shift_y;
+  uint8_t* planes[3];
+  uint32_t strides[3];
+
+  planes[0] = g->text_box;
+  planes[1] = planes[0] + RXS_TEXT_W * RXS_TEXT_H * pss;
+  planes[2] = (1 == g->uv_interleaved) ? NULL : planes[1] + uv_w * uv_h * pss;
+  strides[0] = RXS_TEXT_W * pss;
+  strides[1] = uv_w * pss << g->uv_interleaved;
+  strides[2] = uv_w * pss;
+
+  compose_text_box(g, planes, strides, 0, 0, frame, color);
+}
+
+/* ----------------------------------------------------------------------------------- */
+/*                          S T R E S S   P A T T E R N S                              */
+/* ----------------------------------------------------------------------------------- */
+
+#define RXS_PATTERN_CHUNK 512 /* 8-bit pattern values that are generated at once before they're converted or interleaved. */
+
+/* The tables that `draw_pattern()` uses, filled once by `video_generator_init()`. */
+static void init_pattern(video_generator* g) {
+
+  uint32_t x;
+  uint32_t size = MAX(g->width, g->height);
+  uint16_t mask = 0xffff;
+  int64_t dx;
+
+  /* 8-bit values are scaled like the colors (see `make_color()`), swapped when the byte order isn't native. */
+  g->pattern_swap = (1 != swizzle16(1, g->byte_order)) ? 1 : 0;
+
+  /* the noise keeps the samples within the bitdepth, and at the top for P010 and P016. */
+  g->noise_mask = 0xffffffff;
+  if (2 == g->pixel_size_in_bytes) {
+    mask = (uint16_t)((1u << g->bitdepth) - 1);
+    if (1 == g->uv_interleaved) {
+      mask = (uint16_t)(mask << (16 - g->bitdepth));
+    }
+    mask = swizzle16(mask, g->byte_order);
+    g->noise_mask = ((uint32_t)mask << 16) | mask;
+  }
+
+  /*
+    The phase of the zone plate is (dx^2 + dy^2) / (2 * size) cycles
+    for a pixel at dx, dy from the center: the frequency grows linearly
+    to half the sample rate at `size / 2`. One cycle is 65536.
+  */
+  if (NULL != g->zone_phase) {
+    for (x = 0; x < g->width; ++x) {
+      dx = (int64_t)x - (int64_t)(g->width / 2);
+      g->zone_phase[x] = (uint16_t)(((uint64_t)(dx * dx) * 32768) / size);
+    }
+    for (x = 0; x < g->uv_width; ++x) {
+      dx = (int64_t)(x << g->uv_shift_x) - (int64_t)(g->width / 2);
+      g->zone_phase[g->width + x] = (uint16_t)(((uint64_t)(dx * dx) * 32768) / size);
+    }
+  }
+}
+
+/* Makes `job` draw the pattern for `frame`. */
+static void set_pattern(video_generator* g, uint64_t frame, render_job* job) {
+  job->pattern = g->pattern;
+  job->pattern_frame = frame;
+  job->noise_key = lowbias32(g->seed ^ lowbias32((uint32_t)frame ^ lowbias32((uint32_t)(frame >> 32) ^ 0x9e3779b9U)));
+}
+
+/* Draws the rows of the pattern that are part of `band`, in all planes. */
+static void draw_pattern(render_job* job, const render_band* band) {
+
+  video_generator* g = job->g;
+  uint32_t row;
+
+  for (row = band->y0; row < band->y1; ++row) {
+    pattern_row(job, 0, row, job->planes[0] + (size_t)row * job->strides[0]);
+  }
+
+  if (0 == g->uv_width) {
+    return;
+  }
+
+  for (row = band->uv_y0; row < band->uv_y1; ++row) {
+    pattern_row(job, 1, row, job->planes[1] + (size_t)row * job->strides[1]);
+    if (0 == g->uv_interleaved) {
+      pattern_row(job, 2, row, job->planes[2] + (size_t)row * job->strides[2]);
+    }
+  }
+}
+
+/* Draws one row of `plane`; for the interleaved formats plane 1 holds the u and v values. */
+static void pattern_row(render_job* job, uint32_t plane, uint32_t row, uint8_t* dst) {
+
+  video_generator* g = job->g;
+  uint8_t values[2][RXS_PATTERN_CHUNK];
+  uint32_t pss = g->pixel_size_in_bytes;
+  uint32_t n = (0 == plane) ? g->width : g->uv_width;
+  uint32_t nvalues = (0 != plane && 1 == g->uv_interleaved) ? 2 : 1;
+  uint32_t words = (g->width * pss + 3) / 4;
+  uint32_t i, j, c, k;
+
+  /* every row of every plane has its own range of counters. */
+  if (VIDEO_GENERATOR_PATTERN_NOISE == job->pattern) {
+    g->noise(dst, n * nvalues * pss, (row * 3 + plane) * words, job->noise_key, g->noise_mask);
+    return;
+  }
+
+  if (1 == pss && 1 == nvalues) {
+    pattern_values(job, plane, row, 0, n, dst);
+    return;
+  }
+
+  for (i = 0; i < n; i += k) {
+    k = MIN(n - i, RXS_PATTERN_CHUNK);
+    for (c = 0; c < nvalues; ++c) {
+      pattern_values(job, plane + c, row, i, k, values[c]);
+    }
+    if (1 == pss) {
+      for (j = 0; j < k; ++j) {
+        dst[j * 2 + 0] = values[0][j];
+        dst[j * 2 + 1] = values[1][j];
+      }
+    }
+    else {
+      g->widen(dst, values[0], (2 == nvalues) ? values[1] : NULL, k, g->pixel_factor, g->pattern_swap);
+    }
+    dst += k * nvalues * pss;
+  }
+}
+
+/*
+  Writes `n` 8-bit values of the gradient or zone plate, starting at
+  column `x` of `row` of `plane`. The gradient moves 4 pixels right and
+  2 down per frame, by whole chroma samples in the u and v planes; the
+  zone plate rings move outwards by 1/64th of a cycle per frame.
+*/
+static void pattern_values(render_job* job, uint32_t plane, uint32_t row, uint32_t x, uint32_t n, uint8_t* dst) {
+
+  video_generator* g = job->g;
+  uint32_t f = (uint32_t)job->pattern_frame;
+  uint32_t size = MAX(g->width, g->height);
+  uint32_t mx, my;
+  uint16_t add;
+  int64_t dy;
+
+  if (VIDEO_GENERATOR_PATTERN_GRADIENT == job->pattern) {
+    mx = (0 == plane) ? x + f * 4 : x + ((f * 4) >> g->uv_shift_x);
+    my = (0 == plane) ? row + f * 2 : row + ((f * 2) >> g->uv_shift_y);
+    switch (plane) {
+      case 0:  { g->gradient(dst, n, mx, (uint8_t)my, (uint8_t)(my >> 1)); break; }
+      case 1:  { g->gradient(dst, n, mx, (uint8_t)my, (uint8_t)((my >> 1) + 128)); break; }
+      default: { g->gradient(dst, n, mx + 128, (uint8_t)my, (uint8_t)(64 - (my >> 1))); break; }
+    }
+    return;
+  }
+
+  dy = (int64_t)(row << ((0 == plane) ? 0 : g->uv_shift_y)) - (int64_t)(g->height / 2);
+  add = (uint16_t)(((uint64_t)(dy * dy) * 32768) / size + f * 1024 + (plane * 16384));
+  g->zone(dst, g->zone_phase + ((0 == plane) ? 0 : g->width) + x, n, add);
+}
+
+/* ----------------------------------------------------------------------------------- */
+/*                          R E N D E R   T H R E A D S                                */
+/* ----------------------------------------------------------------------------------- */
+
+struct video_generator_workers {
+  thread* threads[RXS_MAX_THREADS];
+  uint32_t nthreads;
+  mutex mutex;                                            /* protects all members below. */
+  cond work_cond;                                         /* signalled when jobs are added or when the threads must stop. */
+  cond done_cond;                                         /* signalled when the last job has finished. */
+  void(*func)(void* user, uint32_t index);                /* the function that executes a job. */
+  void* user;
+  uint32_t njobs;                                         /* number of jobs of the current run. */
+  uint32_t next_job;                                      /* the next job that a thread can pick up. */
+  uint32_t ndone;                                         /* number of finished jobs. */
+  uint8_t must_stop;
+  mutex run_mutex;                                        /* held by `workers_run()`, so the generators of a context take turns. */
+};
+
+static void* worker_thread(void* user) {
+
+  video_generator_workers* w = (video_generator_workers*)user;
+  uint32_t index;
+
+  mutex_lock(&w->mutex);
+
+  while (1) {
+
+    while (0 == w->must_stop && w->next_job >= w->njobs) {
+      cond_wait(&w->work_cond, &w->mutex);
+    }
+
+    if (1 == w->must_stop) {
+      break;
+    }
+
+    index = w->next_job++;
+
+    mutex_unlock(&w->mutex);
+      w->func(w->user, index);
+    mutex_lock(&w->mutex);
+
+    w->ndone++;
+    if (w->ndone == w->njobs) {
+      cond_signal(&w->done_cond);
+    }
+  }
+
+  mutex_unlock(&w->mutex);
+
+  return NULL;
+}
+
+static video_generator_workers* workers_alloc(uint32_t nthreads) {
+
+  video_generator_workers* w;
+  uint32_t i;
+
+  if (0 == nthreads || nthreads > RXS_MAX_THREADS) {
+    return NULL;
+  }
+
+  w = (video_generator_workers*)calloc(1, sizeof(video_generator_workers));
+  if (NULL == w) {
+    return NULL;
+  }
+
+  if (0 != mutex_init(&w->mutex)) {
+    free(w);
+    return NULL;
+  }
+
+  if (0 != mutex_init(&w->run_mutex)) {
+    mutex_destroy(&w->mutex);
+    free(w);
+    return NULL;
+  }
+
+  if (0 != cond_init(&w->work_cond)) {
+    mutex_destroy(&w->run_mutex);
+    mutex_destroy(&w->mutex);
+    free(w);
+    return NULL;
+  }
+
+  if (0 != cond_init(&w->done_cond)) {
+    cond_destroy(&w->work_cond);
+    mutex_destroy(&w->run_mutex);
+    mutex_destroy(&w->mutex);
+    free(w);
+    return NULL;
+  }
+
+  for (i = 0; i < nthreads; ++i) {
+    w->threads[i] = thread_alloc(worker_thread, (void*)w);
+    if (NULL == w->threads[i]) {
+      workers_free(w);
+      return NULL;
+    }
+    w->nthreads++;
+  }
+
+  return w;
+}
+
+static int workers_free(video_generator_workers* w) {
+
+  uint32_t i;
+
+  if (NULL == w) {
+    return -1;
+  }
+
+  mutex_lock(&w->mutex);
+    w->must_stop = 1;
+    cond_broadcast(&w->work_cond);
+  mutex_unlock(&w->mutex);
+
+  for (i = 0; i < w->nthreads; ++i) {
+    thread_join(w->threads[i]);
+    thread_free(w->threads[i]);
+  }
+
+  cond_destroy(&w->done_cond);
+  cond_destroy(&w->work_cond);
+  mutex_destroy(&w->run_mutex);
+  mutex_destroy(&w->mutex);
+  free(w);
+
+  return 0;
+}
+
+/* Executes `func` for the job indices 0 .. njobs - 1 and returns when all of them have finished. */
+static void workers_run(video_generator_workers* w, uint32_t njobs, void(*func)(void* user, uint32_t index), void* user) {
+
+  uint32_t index;
+
+  mutex_lock(&w->run_mutex);
+  mutex_lock(&w->mutex);
+
+  w->func = func;
+  w->user = user;
+  w->njobs = njobs;
+  w->next_job = 0;
+  w->ndone = 0;
+  cond_broadcast(&w->work_cond);
+
+  /* the calling thread helps out. */
+  while (w->next_job < w->njobs) {
+    index = w->next_job++;
+    mutex_unlock(&w->mutex);
+      func(user, index);
+    mutex_lock(&w->mutex);
+    w->ndone++;
+  }
+
+  while (w->ndone < w->njobs) {
+    cond_wait(&w->done_cond, &w->mutex);
+  }
+
+  w->njobs = 0;
+  w->next_job = 0;
+
+  mutex_unlock(&w->mutex);
+  mutex_unlock(&w->run_mutex);
+}
+
+/* ----------------------------------------------------------------------------------- */
+/*                          R E N D I T I O N S                                        */
+/* ----------------------------------------------------------------------------------- */
+
+struct video_generator_multi_jobs {
+  render_batch batch;
+};
+
+/*
+  Initializes one generator per rendition. The renditions render on
+  the shared threads of `m` so their own `nthreads` is ignored; only
+  the first rendition has audio, the audio settings of the others are
+  ignored.
+*/
+int video_generator_multi_init(video_generator_settings* cfgs, uint32_t count, uint32_t nthreads, video_generator_multi* m) {
+
+  video_generator_settings cfg;
+  uint32_t fps, i;
+
+  if (!m) { return -1; }
+  if (!cfgs || 0 == count || count > RXS_MAX_RENDITIONS) { return -2; }
+
+  m->count = 0;
+  m->nthreads = 1;
+  m->workers = NULL;
+  m->jobs = NULL;
+
+  fps = (0 == cfgs[0].fps) ? DEFAULT_FPS : cfgs[0].fps;
+  for (i = 0; i < count; ++i) {
+    if (0 != cfgs[i].cycle_cache) {
+      log_error("Error: rendition %u uses the cycle cache, which can't be shared.", i);
+      return -3;
     }
+    if (fps != ((0 == cfgs[i].fps) ? DEFAULT_FPS : cfgs[i].fps)) {
+      log_error("Error: all renditions need the same fps to share a timeline.");
+      return -4;
+    }
+  }
+
+  m->jobs = (video_generator_multi_jobs*)calloc(1, sizeof(video_generator_multi_jobs));
+  if (NULL == m->jobs) {
+    log_error("Error: cannot allocate the rendition jobs.");
+    return -5;
+  }
+
+  for (i = 0; i < count; ++i) {
+    cfg = cfgs[i];
+    cfg.nthreads = 1;
+    if (0 != i) {
+      cfg.audio_callback = NULL;
+      cfg.audio_mode = VIDEO_GENERATOR_AUDIO_CALLBACK;
+    }
+    if (0 != video_generator_init(&cfg, &m->renditions[i])) {
+      log_error("Error: cannot initialize rendition %u.", i);
+      video_generator_multi_clear(m);
+      return -6;
+    }
+    m->count++;
+  }
+
+  m->nthreads = MIN(MAX(nthreads, 1), RXS_MAX_THREADS);
+  if (m->nthreads > 1) {
+    m->workers = workers_alloc(m->nthreads - 1);
+    if (NULL == m->workers) {
+      log_error("Error: cannot create the render threads.");
+      video_generator_multi_clear(m);
+      return -7;
+    }
+    if (0 != (cfgs[0].alloc_flags & VIDEO_GENERATOR_ALLOC_NUMA) && 0 != workers_bind(m->workers, cfgs[0].numa_node)) {
+      log_error("Error: cannot run the render threads on numa node %u.", cfgs[0].numa_node);
+      video_generator_multi_clear(m);
+      return -7;
+    }
+  }
+
+  return 0;
+}
+
+/*
+  Renders the next frame of every rendition. The bip/bop flags and the
+  time stamp are sampled once so the renditions show exactly the same
+  content, then the bands of all renditions are handed to the render
+  threads at once: a large rendition is split into more bands than a
+  small one so the threads stay busy until the last band is done.
+*/
+int video_generator_multi_update(video_generator_multi* m) {
+
+  render_batch* b;
+  video_generator* lead;
+  video_generator* g;
+  render_timeline timeline;
+  uint8_t* planes[3];
+  uint32_t strides[3];
+  uint32_t i;
+
+  if (!m) { return -1; }
+  if (!m->jobs || 0 == m->count) { return -2; }
+
+  b = &m->jobs->batch;
+  b->nbands = 0;
+  lead = &m->renditions[0];
+
+  /* the bar is the only thing that can fail, check it for all renditions before any of them changes. */
+  for (i = 0; i < m->count; ++i) {
+    g = &m->renditions[i];
+    if (0 != layout_bar(g, g->perc, next_perc(g), &b->jobs[i])) {
+      return -3;
+    }
+  }
+
+  for (i = 0; i < m->count; ++i) {
+    b->start[i] = stats_frame_start(&m->renditions[i]);
+  }
+
+  if (VIDEO_GENERATOR_AUDIO_OFFLINE == lead->audio_mode && NULL != lead->audio_buffer) {
+    offline_audio(lead);
+  }
+
+  timeline.is_bip = 0;
+  timeline.is_bop = 0;
+  timeline.now = ns();
+  if (NULL != lead->audio_buffer) {
+    timeline.is_bip = ATOMIC_LOAD8(&lead->audio_is_bip);
+    timeline.is_bop = ATOMIC_LOAD8(&lead->audio_is_bop);
+  }
+
+  for (i = 0; i < m->count; ++i) {
+    g = &m->renditions[i];
+    planes[0] = g->y;
+    planes[1] = g->u;
+    planes[2] = g->v;
+    plane_strides(g, strides);
+    if (0 != prepare_frame(g, planes, strides, &g->dirty, &timeline, &b->jobs[i])) {
+      return -3;
+    }
+    b->jobs[i].max_bands = m->nthreads;
+    batch_add(b, i);
+  }
+
+  draw_batch(m->workers, b);
+
+  for (i = 0; i < m->count; ++i) {
+    finish_frame(&m->renditions[i], &b->jobs[i], b->start[i]);
+  }
+
+  return 0;
+}
+
+int video_generator_multi_clear(video_generator_multi* m) {
+
+  uint32_t i;
+
+  if (!m) { return -1; }
+
+  if (NULL != m->workers) {
+    workers_free(m->workers);
+    m->workers = NULL;
+  }
+
+  for (i = 0; i < m->count; ++i) {
+    video_generator_clear(&m->renditions[i]);
+  }
+
+  free(m->jobs);
+  m->jobs = NULL;
+  m->count = 0;
+
+  return 0;
+}
+
+/* ----------------------------------------------------------------------------------- */
+/*                          C O N T E X T                                              */
+/* ----------------------------------------------------------------------------------- */
+
+int video_generator_context_init(uint32_t nthreads, uint8_t realtime, video_generator_context* ctx) {
+
+  if (!ctx) { return -1; }
+
+  global_init_once();
+
+  memset(ctx, 0x00, sizeof(*ctx));
+  ctx->timer_realtime = (0 != realtime) ? 1 : 0;
+
+  if (0 != mutex_init(&ctx->timer_mutex)) {
+    log_error("Error: cannot initialize the timer mutex.");
+    return -2;
+  }
+
+  ctx->nthreads = MIN(MAX(nthreads, 1), RXS_MAX_THREADS);
+  if (ctx->nthreads > 1) {
+    ctx->workers = workers_alloc(ctx->nthreads - 1);
+    if (NULL == ctx->workers) {
+      log_error("Error: cannot create the render threads.");
+      mutex_destroy(&ctx->timer_mutex);
+      return -3;
+    }
+  }
+
+  ctx->timer_thread = thread_alloc(timer_thread, (void*)ctx);
+  if (NULL == ctx->timer_thread) {
+    log_error("Error: cannot create the timer thread.");
+    workers_free(ctx->workers);
+    ctx->workers = NULL;
+    mutex_destroy(&ctx->timer_mutex);
+    return -4;
+  }
+
+  return 0;
+}
+
+int video_generator_context_clear(video_generator_context* ctx) {
+
+  uint32_t nusers;
+
+  if (!ctx) { return -1; }
+  if (NULL == ctx->timer_thread) { return -3; }
+
+  mutex_lock(&ctx->timer_mutex);
+    nusers = ctx->nusers;
+  mutex_unlock(&ctx->timer_mutex);
+
+  if (0 != nusers) {
+    log_error("Error: %u generators still use the context.", nusers);
+    return -2;
+  }
+
+  ATOMIC_STORE8(&ctx->timer_must_stop, 1);
+  thread_join(ctx->timer_thread);
+  thread_free(ctx->timer_thread);
+  ctx->timer_thread = NULL;
+
+  if (NULL != ctx->workers) {
+    workers_free(ctx->workers);
+    ctx->workers = NULL;
+  }
+
+  mutex_destroy(&ctx->timer_mutex);
+  ctx->nthreads = 0;
+
+  return 0;
+}
+
+/*
+  Delivers the audio of all generators of the context from one thread:
+  it sleeps until the earliest deadline and then calls `audio_tick()`
+  for every generator whose chunk is due. The chunks are produced with
+  the mutex held so `context_leave()` can't pull a generator away while
+  its callback runs. A generator that is added while the thread sleeps
+  gets its first chunk when it wakes up, at most RXS_TIMER_IDLE later.
+*/
+static void* timer_thread(void* user) {
+
+  video_generator_context* ctx = (video_generator_context*)user;
+  video_generator* g;
+  uint64_t now, deadline;
+
+  if (1 == ctx->timer_realtime && 0 != thread_set_realtime()) {
+    ATOMIC_STORE8(&ctx->timer_realtime, 0);
+  }
+
+  while (0 == ATOMIC_LOAD8(&ctx->timer_must_stop)) {
+
+    mutex_lock(&ctx->timer_mutex);
+      now = ns();
+      deadline = now + RXS_TIMER_IDLE;
+      for (g = ctx->timers; NULL != g; g = g->timer_next) {
+        if (g->audio_deadline <= now) {
+          if (1 == g->stats_enabled) {
+            stats_audio_wakeup(g, now - g->audio_deadline);
+          }
+          audio_tick(g);
+        }
+        deadline = MIN(deadline, g->audio_deadline);
+      }
+    mutex_unlock(&ctx->timer_mutex);
+
+    sleep_until(deadline);
+  }
+
+  return NULL;
+}
+
+/*
+  Makes `g` a user of `ctx`; with `audio` set the timer thread of the
+  context delivers its chunks from now on.
+*/
+static void context_join(video_generator_context* ctx, video_generator* g, uint8_t audio) {
+
+  mutex_lock(&ctx->timer_mutex);
+    g->context = ctx;
+    if (1 == audio) {
+      g->audio_deadline = ns();
+      g->audio_realtime = ATOMIC_LOAD8(&ctx->timer_realtime);
+      g->timer_next = ctx->timers;
+      ctx->timers = g;
+    }
+    ctx->nusers++;
+  mutex_unlock(&ctx->timer_mutex);
+}
+
+static void context_leave(video_generator* g) {
+
+  video_generator_context* ctx = g->context;
+  video_generator** link;
+
+  mutex_lock(&ctx->timer_mutex);
+    for (link = &ctx->timers; NULL != *link; link = &(*link)->timer_next) {
+      if (g == *link) {
+        *link = g->timer_next;
+        break;
+      }
+    }
+    g->timer_next = NULL;
+    ctx->nusers--;
+  mutex_unlock(&ctx->timer_mutex);
+
+  if (g->workers == ctx->workers) {
+    g->workers = NULL;
+  }
+  g->context = NULL;
+}
+
+/* ----------------------------------------------------------------------------------- */
+/*                          M E M O R Y                                                */
+/* ----------------------------------------------------------------------------------- */
+
+#if defined(__linux) || defined(__APPLE__)
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#if defined(__linux)
+#  include <sched.h>
+#  include <sys/syscall.h>
+#  define RXS_MPOL_BIND 2 /* from <numaif.h>, we don't want to depend on libnuma for one syscall. */
+#endif
+
+/*
+  Maps `nbytes` (a multiple of the huge page size when huge pages are
+  requested) for a frame buffer. We first try explicit huge pages
+  (MAP_HUGETLB, MEM_LARGE_PAGES), which need a reserved pool or a
+  privilege, and fall back to normal pages; on Linux these are aligned
+  to a huge page and marked with MADV_HUGEPAGE so transparent huge
+  pages can back them. With a numa node the pages are bound to it
+  before they're touched.
+*/
+#if defined(_WIN32)
+
+static uint8_t* map_frame(video_generator* g, size_t nbytes) {
+  DWORD type = MEM_RESERVE | MEM_COMMIT;
+  DWORD node = (0 != (g->alloc_flags & VIDEO_GENERATOR_ALLOC_NUMA)) ? g->numa_node : NUMA_NO_PREFERRED_NODE;
+  SIZE_T large = GetLargePageMinimum();
+  void* mem = NULL;
+  if (0 != (g->alloc_flags & VIDEO_GENERATOR_ALLOC_HUGEPAGES) && 0 != large && 0 == (nbytes % large)) {
+    mem = VirtualAllocExNuma(GetCurrentProcess(), NULL, nbytes, type | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+  }
+  if (NULL == mem) {
+    mem = VirtualAllocExNuma(GetCurrentProcess(), NULL, nbytes, type, PAGE_READWRITE, node);
+  }
+  return (uint8_t*)mem;
+}
+
+static void unmap_frame(uint8_t* frame, size_t nbytes) {
+  (void)nbytes;
+  VirtualFree(frame, 0, MEM_RELEASE);
+}
+
+/* Returns 0 when `node` has processors, and stores their GROUP_AFFINITY in `cpus` when it's set. */
+static int numa_node_cpus(uint32_t node, void* cpus) {
+  GROUP_AFFINITY affinity;
+  if (node >= RXS_MAX_NUMA_NODES || !GetNumaNodeProcessorMaskEx((USHORT)node, &affinity) || 0 == affinity.Mask) {
+    return -1;
+  }
+  if (NULL != cpus) {
+    memcpy(cpus, &affinity, sizeof(affinity));
+  }
+  return 0;
+}
+
+static int workers_bind(video_generator_workers* w, uint32_t node) {
+  GROUP_AFFINITY affinity;
+  uint32_t i;
+  if (0 != numa_node_cpus(node, &affinity)) {
+    return -1;
+  }
+  for (i = 0; i < w->nthreads; ++i) {
+    if (!SetThreadGroupAffinity(w->threads[i]->handle, &affinity, NULL)) {
+      return -2;
+    }
+  }
+  return 0;
+}
+
+#elif defined(__linux) || defined(__APPLE__)
+
+static uint8_t* map_frame(video_generator* g, size_t nbytes) {
+
+  uint8_t* mem = MAP_FAILED;
+  uint8_t* start;
+  size_t extra = 0;
+  size_t head;
+
+#if defined(MAP_HUGETLB)
+  if (0 != (g->alloc_flags & VIDEO_GENERATOR_ALLOC_HUGEPAGES)) {
+    mem = (uint8_t*)mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif
+
+  if (MAP_FAILED == mem) {
+    /* map one huge page more so we can cut out a range that is aligned to it. */
+    extra = (0 != (g->alloc_flags & VIDEO_GENERATOR_ALLOC_HUGEPAGES)) ? RXS_HUGE_PAGE_SIZE : 0;
+    start = (uint8_t*)mmap(NULL, nbytes + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == start) {
+      return NULL;
+    }
+    mem = start;
+    if (0 != extra) {
+      head = (RXS_HUGE_PAGE_SIZE - ((uintptr_t)start & (RXS_HUGE_PAGE_SIZE - 1))) & (RXS_HUGE_PAGE_SIZE - 1);
+      mem = start + head;
+      if (0 != head) {
+        munmap(start, head);
+      }
+      if (extra != head) {
+        munmap(mem + nbytes, extra - head);
+      }
+#if defined(MADV_HUGEPAGE)
+      madvise(mem, nbytes, MADV_HUGEPAGE);
+#endif
+    }
+  }
+
+#if defined(__linux)
+  if (0 != (g->alloc_flags & VIDEO_GENERATOR_ALLOC_NUMA)) {
+    unsigned long mask = 1UL << g->numa_node;
+    if (0 != syscall(SYS_mbind, mem, nbytes, RXS_MPOL_BIND, &mask, (unsigned long)RXS_MAX_NUMA_NODES + 1, 0)) {
+      munmap(mem, nbytes);
+      return NULL;
+    }
+  }
+#endif
+
+  return mem;
+}
+
+static void unmap_frame(uint8_t* frame, size_t nbytes) {
+  munmap(frame, nbytes);
+}
+
+/* Returns 0 when `node` has cpus, and stores them in the cpu_set_t `cpus` when it's set. Parses the "0-7,16-23" cpulist of sysfs. */
+static int numa_node_cpus(uint32_t node, void* cpus) {
+#if defined(__linux)
+  char path[64];
+  char list[1024];
+  char* p = list;
+  char* end;
+  cpu_set_t* set = (cpu_set_t*)cpus;
+  unsigned long from, to;
+  size_t n;
+  FILE* fp;
+  int count = 0;
+
+  if (node >= RXS_MAX_NUMA_NODES) {
+    return -1;
+  }
+
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+  fp = fopen(path, "r");
+  if (NULL == fp) {
+    return -2;
+  }
+  n = fread(list, 1, sizeof(list) - 1, fp);
+  fclose(fp);
+  list[n] = '\0';
+
+  if (NULL != set) {
+    CPU_ZERO(set);
+  }
+
+  while (*p >= '0' && *p <= '9') {
+    from = strtoul(p, &end, 10);
+    to = from;
+    if ('-' == *end) {
+      to = strtoul(end + 1, &end, 10);
+    }
+    for (; from <= to && from < CPU_SETSIZE; ++from) {
+      if (NULL != set) {
+        CPU_SET(from, set);
+      }
+      count++;
+    }
+    p = (',' == *end) ? end + 1 : end;
+  }
+
+  return (0 == count) ? -3 : 0;
+#else
+  (void)node;
+  (void)cpus;
+  return -1;
+#endif
+}
+
+static int workers_bind(video_generator_workers* w, uint32_t node) {
+#if defined(__linux)
+  cpu_set_t set;
+  uint32_t i;
+  if (0 != numa_node_cpus(node, &set)) {
+    return -1;
+  }
+  for (i = 0; i < w->nthreads; ++i) {
+    if (0 != pthread_setaffinity_np(w->threads[i]->handle, sizeof(set), &set)) {
+      return -2;
+    }
+  }
+  return 0;
+#else
+  (void)w;
+  (void)node;
+  return -1;
+#endif
+}
+
+#endif
+
+/* ----------------------------------------------------------------------------------- */
+/*                          S H A R E D   M E M O R Y                                  */
+/* ----------------------------------------------------------------------------------- */
+
+/*
+  Creates the ring `name` and fills its header. The slots have the
+  layout of `y`, `u` and `v` and start at a page boundary. A ring that
+  is left behind by a generator that crashed is reused.
+*/
+int video_generator_shm_create(video_generator* g, const char* name, uint32_t nslots, video_generator_shm* shm) {
+
+  video_generator_shm_header* h;
+  uint32_t strides[3];
+  uint64_t header_bytes, slot_bytes;
+
+  if (!g) { return -1; }
+  if (!name || !shm) { return -2; }
+  if (0 == nslots || nslots > RXS_MAX_SHM_SLOTS || strlen(name) >= RXS_MAX_SHM_NAME) { return -2; }
+  if (!g->width || !g->height) { return -3; }
+
+  memset(shm, 0x00, sizeof(*shm));
+
+  header_bytes = (sizeof(video_generator_shm_header) + RXS_PAGE_SIZE - 1) & ~(uint64_t)(RXS_PAGE_SIZE - 1);
+  slot_bytes = ((uint64_t)g->nbytes + RXS_PAGE_SIZE - 1) & ~(uint64_t)(RXS_PAGE_SIZE - 1);
+
+  if (0 != shm_map(shm, name, header_bytes + slot_bytes * nslots, 1)) {
+    log_error("Error: cannot create the shared memory ring %s.", name);
+    return -4;
+  }
+
+  shm->is_writer = 1;
+  shm->slots = (uint8_t*)shm->header + header_bytes;
+
+  plane_strides(g, strides);
+
+  h = shm->header;
+  memset(h, 0x00, sizeof(*h));
+  h->version = VIDEO_GENERATOR_SHM_VERSION;
+  h->nslots = nslots;
+  h->width = g->width;
+  h->height = g->height;
+  h->fps = g->fps_den;
+  h->format = g->format;
+  h->bitdepth = g->bitdepth;
+  h->byte_order = g->byte_order;
+  h->offsets[0] = 0;
+  h->offsets[1] = (NULL != g->u) ? (uint32_t)(g->u - g->y) : 0;
+  h->offsets[2] = (NULL != g->v) ? (uint32_t)(g->v - g->y) : 0;
+  h->strides[0] = strides[0];
+  h->strides[1] = strides[1];
+  h->strides[2] = strides[2];
+  h->plane_bytes[0] = g->ybytes;
+  h->plane_bytes[1] = g->ubytes;
+  h->plane_bytes[2] = g->vbytes;
+  h->slot_bytes = slot_bytes;
+  h->slots_offset = header_bytes;
+
+  ATOMIC_FENCE();
+  h->magic = VIDEO_GENERATOR_SHM_MAGIC;
+
+  return 0;
+}
+
+/*
+  Renders the next frame into slot `write_count % nslots`. The slot is
+  marked as being written first, so a reader that still uses the frame
+  that was in it before sees that in `video_generator_shm_check()`.
+  The readers are never waited for: when they're too slow they miss
+  frames, the generator doesn't.
+*/
+int video_generator_shm_update(video_generator* g, video_generator_shm* shm) {
+
+  video_generator_shm_header* h;
+  uint8_t* planes[3];
+  uint32_t strides[3];
+  uint64_t seq, frame;
+  uint32_t slot;
+  uint8_t* dst;
+  int r;
+
+  if (!g) { return -1; }
+  if (!shm || !shm->header || 0 == shm->is_writer) { return -2; }
+
+  h = shm->header;
+  if (h->width != g->width || h->height != g->height || h->slot_bytes < g->nbytes) { return -3; }
+  seq = h->write_count;
+  slot = (uint32_t)(seq % h->nslots);
+  dst = shm->slots + slot * h->slot_bytes;
+  frame = g->frame;
+
+  planes[0] = dst + h->offsets[0];
+  planes[1] = dst + h->offsets[1];
+  planes[2] = dst + h->offsets[2];
+  plane_strides(g, strides);
+
+  ATOMIC_STORE64(&h->slot_seq[slot], 0);
+  ATOMIC_FENCE();
+
+  if (NULL != g->cycle) {
+    copy_frame(g, planes, strides, serve_cycle(g));
+  }
+  else if (0 != (r = render(g, planes, strides, &shm->dirty[slot]))) {
+    return r;
+  }
+
+  ATOMIC_STORE64(&h->slot_frame[slot], frame);
+  ATOMIC_STORE64(&h->slot_seq[slot], seq + 1);
+  ATOMIC_STORE64(&h->write_count, seq + 1);
+
+  return 0;
+}
+
+int video_generator_shm_open(const char* name, video_generator_shm* shm) {
+
+  video_generator_shm_header* h;
+
+  if (!name || !shm) { return -2; }
+  if (strlen(name) >= RXS_MAX_SHM_NAME) { return -2; }
+
+  memset(shm, 0x00, sizeof(*shm));
+
+  if (0 != shm_map(shm, name, 0, 0)) {
+    return -3;
+  }
+
+  h = shm->header;
+  if (shm->nbytes < sizeof(*h)
+      || VIDEO_GENERATOR_SHM_MAGIC != h->magic
+      || VIDEO_GENERATOR_SHM_VERSION != h->version
+      || 0 == h->nslots || h->nslots > RXS_MAX_SHM_SLOTS
+      || shm->nbytes < h->slots_offset + h->slot_bytes * h->nslots)
+    {
+      shm_unmap(shm);
+      return -4;
+    }
+
+  ATOMIC_FENCE();
+  shm->slots = (uint8_t*)h + h->slots_offset;
+
+  return 0;
+}
+
+int video_generator_shm_latest(video_generator_shm* shm, uint64_t* seq) {
+
+  uint64_t count;
+
+  if (!shm || !shm->header) { return -1; }
+  if (!seq) { return -2; }
+
+  count = ATOMIC_LOAD64(&shm->header->write_count);
+  if (0 == count) {
+    return -3;
   }
 
-  if (!g) { return -1; }
-  if (!g->width) { return -2; }
-  if (!g->height) { return -3; }
+  *seq = count - 1;
+
+  return 0;
+}
+
+/*
+  Points `planes` at frame `seq` of the ring, without copying
+  anything. The generator may overwrite the slot at any time, so when
+  you're done with the frame call `video_generator_shm_check()` and
+  throw away what you did when it fails.
+*/
+int video_generator_shm_peek(video_generator_shm* shm, uint64_t seq, const uint8_t* planes[3], uint64_t* frame) {
+
+  video_generator_shm_header* h;
+  const uint8_t* src;
+  uint32_t slot;
 
-  if (g->y) {
-    free(g->y);
+  if (!shm || !shm->header) { return -1; }
+  if (!planes) { return -2; }
+
+  h = shm->header;
+  if (seq >= ATOMIC_LOAD64(&h->write_count)) {
+    return -3;
   }
 
-  g->y = NULL;
-  g->u = NULL;
-  g->u = NULL;
-  g->width = 0;
-  g->height = 0;
-  g->frame = 0;
-  g->step = 0.0;
-  g->perc = 0.0;
-  g->fps = 0.0;
-  g->ybytes = 0;
-  g->ubytes = 0;
-  g->vbytes = 0;
-  g->nbytes = 0;
-  g->u_factor = 0.0;
-  g->v_factor = 0.0;
-  g->onecolor = 0;
+  slot = (uint32_t)(seq % h->nslots);
+  if (seq + 1 != ATOMIC_LOAD64(&h->slot_seq[slot])) {
+    return -4;
+  }
 
-  g->audio_nchannels = 0;
-  g->audio_nseconds = 0;
-  g->audio_samplerate = 0;
-  g->audio_bip_frequency = 0;
-  g->audio_bop_frequency = 0;
-  g->audio_bip_millis = 0;
-  g->audio_bop_millis = 0;
-  g->audio_nbytes = 0;
-  g->audio_callback = NULL;
+  src = shm->slots + slot * h->slot_bytes;
+  planes[0] = src + h->offsets[0];
+  planes[1] = (0 != h->plane_bytes[1]) ? src + h->offsets[1] : NULL;
+  planes[2] = (0 != h->plane_bytes[2]) ? src + h->offsets[2] : NULL;
+
+  if (NULL != frame) {
+    *frame = ATOMIC_LOAD64(&h->slot_frame[slot]);
+  }
 
   return 0;
 }
 
-/* generates a new frame and stores it in the y, u and v members */
-int video_generator_update(video_generator* g) {
+int video_generator_shm_check(video_generator_shm* shm, uint64_t seq) {
 
-  uint8_t is_bip, is_bop;
-  uint32_t text_w, text_h, text_x, text_y;
-  int32_t bar_h, start_y, nlines, h;
-  uint64_t minutes, seconds;
-  uint32_t stride, end_y, i, k;
-  char timebuf[512] = { 0 } ;
-  uint8_t text_r, text_g, text_b;
-  uint8_t rc, gc, bc;
-  uint8_t dx;
-  uint16_t yc, uc, vc;
-  uint8_t colors[] = {
-    255, 255, 255,  // white
-    255, 255, 0,    // yellow
-    0,   255, 255,  // cyan
-    0,   255, 0,    // green
-    255, 0,   255,  // magenta
-    255, 0,   0,    // red
-    0,   0,   255   // blue
-  };
+  video_generator_shm_header* h;
 
-  if (!g) { return -1; }
-  if (!g->width) { return -2; }
-  if (!g->height) { return -3; }
+  if (!shm || !shm->header) { return -1; }
 
-  text_r = 0;
-  text_g = 0;
-  text_b = 0;
+  h = shm->header;
 
-  h = (int32_t)(g->height - 1);
-  bar_h = (int32_t)(g->height / 5);
-  start_y = -bar_h +  (int32_t)(g->perc * (h + bar_h));
+  /* everything that was read from the slot is read before we look at its number again. */
+  ATOMIC_FENCE();
 
-  /* how many lines of the bar are visible */
-  if (start_y < 0) {
-    nlines = bar_h + start_y;
-    start_y = 0;
+  if (seq + 1 != ATOMIC_LOAD64(&h->slot_seq[seq % h->nslots])) {
+    return -4;
   }
-  else if(start_y + bar_h > h) {
-    nlines = h - start_y;
+
+  return 0;
+}
+
+/* Unmaps the ring; the generator also removes it, readers that still have it mapped keep their mapping. */
+int video_generator_shm_close(video_generator_shm* shm) {
+
+  if (!shm) { return -1; }
+
+  shm_unmap(shm);
+  memset(shm, 0x00, sizeof(*shm));
+
+  return 0;
+}
+
+/* Maps `name`, creating it with `nbytes` when `create` is 1 or read-only with the size it has otherwise. */
+static int shm_map(video_generator_shm* shm, const char* name, uint64_t nbytes, uint8_t create) {
+
+#if defined(_WIN32)
+
+  MEMORY_BASIC_INFORMATION info;
+  HANDLE mapping;
+  void* mem;
+
+  if (1 == create) {
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(nbytes >> 32), (DWORD)(nbytes & 0xFFFFFFFF), name);
   }
   else {
-    nlines = bar_h;
+    mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+  }
+  if (NULL == mapping) {
+    return -1;
   }
 
-  /* increment step */
-  g->perc += g->step;
-  if (g->perc >= (1.0)) {
-    g->perc = 0.0;
+  mem = MapViewOfFile(mapping, (1 == create) ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, (SIZE_T)nbytes);
+  if (NULL == mem) {
+    CloseHandle(mapping);
+    return -2;
   }
 
-  if (nlines + start_y >  (int32_t)g->height || nlines < 0 || start_y < 0 || start_y >=  (int32_t)g->height) {
-    printf("Error: this shouldn't happen.. writing outside the buffer: %d, %d, %d\n", nlines, (nlines + start_y), start_y);
+  if (0 == create) {
+    if (0 == VirtualQuery(mem, &info, sizeof(info))) {
+      UnmapViewOfFile(mem);
+      CloseHandle(mapping);
+      return -3;
+    }
+    nbytes = info.RegionSize;
+  }
+
+  shm->handle = mapping;
+
+#else
+
+  struct stat st;
+  void* mem;
+  int fd;
+
+  if (1 == create) {
+    fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+  }
+  else {
+    fd = shm_open(name, O_RDONLY, 0);
+  }
+  if (fd < 0) {
     return -1;
   }
 
-  /* reset */
-  memset(g->y, 0x00, g->ybytes);
-  memset(g->u, 0x00, g->ubytes);
-  memset(g->v, 0x00, g->vbytes);
+  if (1 == create) {
+    if (0 != ftruncate(fd, (off_t)nbytes)) {
+      close(fd);
+      shm_unlink(name);
+      return -2;
+    }
+  }
+  else {
+    if (0 != fstat(fd, &st)) {
+      close(fd);
+      return -3;
+    }
+    nbytes = (uint64_t)st.st_size;
+  }
 
-  if(g->onecolor)
-  {
-    dx = (uint8_t)((g->frame % 7) * 3);
-    rc = colors[dx + 0];
-    gc = colors[dx + 1];
-    bc = colors[dx + 2];
-    fill(g, 0, 0, g->width, g->height, rc, gc, bc);
-    goto beach;
+  if (0 == nbytes) {
+    close(fd);
+    return -3;
   }
 
-  /* Draw the background with 7 colors */
-  for (i = 0; i < 7; ++i) {
-    dx = (uint8_t)(i * 3);
-    rc = colors[dx + 0];
-    gc = colors[dx + 1];
-    bc = colors[dx + 2];
-    fill(g, i * (g->width / 7), 0, (g->width / 7), g->height, rc, gc, bc);
-  }
-
-  /* Draw the moving bar */
-  rc = (uint8_t)(255 - (uint8_t)(g->perc * 255));
-  gc = (uint8_t)(30 + (uint8_t)(g->perc * 235));
-  bc = (uint8_t)(150 + (uint8_t)(g->perc * 205));
-  yc = (uint16_t)(RGB2Y(rc, gc, bc) * g->pixel_factor);
-  uc = (uint16_t)(RGB2U(rc, gc, bc) * g->pixel_factor);
-  vc = (uint16_t)(RGB2V(rc, gc, bc) * g->pixel_factor);
-
-  /* fill y channel */
-  stride = (uint32_t)(g->width * g->pixel_size_in_bytes);
-  for (i = (uint32_t)start_y; i < (uint32_t)(start_y + nlines); ++i) {
-    if(g->pixel_size_in_bytes == 2) {
-      for(k = 0; k < stride; k+=2) {
-        g->y[i * stride + k] = LSB(yc, g->byte_order);
-        g->y[i * stride + k + 1] = MSB(yc, g->byte_order);
-      }
-    } else {
-      memset(g->y + (i * g->width), yc, g->width);
-    }
-  }
-
-  /* fill u and v channel */
-  start_y = (int32_t)(start_y * g->u_factor);
-  stride = (uint32_t)(g->width * g->v_factor * g->pixel_size_in_bytes);
-  end_y = (uint32_t)(start_y + (nlines * g->u_factor));
-  for (i = (uint32_t)start_y; i < end_y; ++i) {
-    if(g->pixel_size_in_bytes == 2) {
-      for(k = 0; k < stride; k++) {
-        g->u[i * stride + k] = LSB(uc, g->byte_order);;
-        g->u[i * stride + k + 1] = MSB(uc, g->byte_order);
-        g->v[i * stride + k] = LSB(vc, g->byte_order);
-        g->v[i * stride + k + 1] = MSB(vc, g->byte_order);;
-      }
-    } else {
-      memset(g->u + i * stride, (uint8_t)uc, stride);
-      memset(g->v + i * stride, (uint8_t)vc, stride);
+  /* the mapping stays valid after the descriptor is closed. */
+  mem = mmap(NULL, (size_t)nbytes, (1 == create) ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (MAP_FAILED == mem) {
+    if (1 == create) {
+      shm_unlink(name);
     }
+    return -2;
   }
 
-  /* draw blip/blop visuals. */
-  if (NULL != g->audio_buffer) {
-    mutex_lock(&g->audio_mutex);
-    {
-      is_bop = g->audio_is_bop;
-      is_bip = g->audio_is_bip;
+#endif
+
+  shm->header = (video_generator_shm_header*)mem;
+  shm->nbytes = nbytes;
+  strcpy(shm->name, name);
+
+  return 0;
+}
+
+static void shm_unmap(video_generator_shm* shm) {
+
+  if (NULL == shm->header) {
+    return;
+  }
+
+#if defined(_WIN32)
+  UnmapViewOfFile(shm->header);
+  CloseHandle((HANDLE)shm->handle);
+  shm->handle = NULL;
+#else
+  munmap(shm->header, (size_t)shm->nbytes);
+  if (1 == shm->is_writer) {
+    shm_unlink(shm->name);
+  }
+#endif
+
+  shm->header = NULL;
+  shm->slots = NULL;
+  shm->nbytes = 0;
+}
+
+/* ----------------------------------------------------------------------------------- */
+/*                          A U D I O  G E N E R A T O R                               */
+/* ----------------------------------------------------------------------------------- */
+
+static void* audio_thread(void* gen) {
+  video_generator* g;
+  uint64_t now;
+
+  /* get the handle. */
+  g = (video_generator*)gen;
+  if (NULL == g) {
+    log_error("Not supposed to happen but the audio thread cannot get a handle to the generator.");
+    exit(1);
+  }
+
+  /* init */
+  if (1 == g->audio_realtime && 0 != thread_set_realtime()) {
+    ATOMIC_STORE8(&g->audio_realtime, 0);
+  }
+  g->audio_deadline = ns();
+
+  while (0 == ATOMIC_LOAD8(&g->audio_thread_must_stop)) {
+
+    audio_tick(g);
+    sleep_until(g->audio_deadline);
 
+    if (1 == g->stats_enabled) {
+      now = ns();
+      stats_audio_wakeup(g, (now > g->audio_deadline) ? now - g->audio_deadline : 0);
     }
-    mutex_unlock(&g->audio_mutex);
+  }
+
+  return NULL;
+}
+
+/*
+  Delivers the chunk that is due at `audio_deadline` and moves the
+  deadline to the next one. Called by the audio thread of `g` or by
+  the timer thread of its context.
+*/
+static void audio_tick(video_generator* g) {
+
+  uint8_t is_bip = 0;
+  uint8_t is_bop = 0;
+  uint64_t now;
+  uint64_t t = 0;
+
+  /* Playing bip or bop? */
+  range_bip_bop(g, g->audio_pos, g->audio_nsamples, &is_bip, &is_bop);
+
+  synth_audio(g, g->audio_pos, g->audio_nsamples, g->audio_buffer);
+  g->audio_pos += g->audio_nsamples;
+
+  if (1 == g->stats_enabled) {
+    t = ns();
+  }
+
+  if (VIDEO_GENERATOR_AUDIO_PULL == g->audio_mode) {
+    ring_write(g, g->audio_buffer, g->audio_nsamples);
+  }
+  else {
+    g->audio_callback((const int16_t*)g->audio_buffer, (uint64_t)g->audio_nsamples * g->audio_frame_bytes, g->audio_nsamples);
+  }
+
+  if (1 == g->stats_enabled) {
+    stats_audio_callback(g, ns() - t);
+  }
+
+  /* Update bip / bop flags. */
+  if (is_bip != g->audio_prev_is_bip) {
+    ATOMIC_STORE8(&g->audio_is_bip, is_bip);
+  }
+  if (is_bop != g->audio_prev_is_bop) {
+    ATOMIC_STORE8(&g->audio_is_bop, is_bop);
+  }
 
-    if (is_bip == 1) {
-      text_r = 0;
-      text_g = 0;
-      text_b = 255;
+  g->audio_prev_is_bip = is_bip;
+  g->audio_prev_is_bop = is_bop;
+
+  /* the next chunk is due one period later; when we fell more than a period behind we don't try to catch up. */
+  g->audio_deadline += g->audio_period;
+  now = ns();
+  if (g->audio_deadline < now) {
+    if (1 == g->stats_enabled) {
+      ATOMIC_STORE64(&g->stats.audio_late, g->stats.audio_late + 1);
     }
-    if (is_bop == 1) {
-      text_r = 255;
-      text_g = 0;
-      text_b = 0;
+    if (NULL != g->audio_late_callback) {
+      g->audio_late_callback(g->audio_chunk, now - g->audio_deadline);
     }
   }
-
-  /* Draw the text box with time stamps */
-  seconds = (g->frame/ g->fps_den);
-  minutes = (seconds / 60);
-  minutes %= 60;
-  seconds %= 60;
-  text_w = 170; /* manually measured */
-  text_h = 100;
-  if (g->width > text_w && g->height > text_h) {
-    if(g->width > text_w)
-      text_x = (g->width / 2) - (text_w / 2);
-    else
-      text_x = 0;
-    if((g->height) > text_h)
-      text_y = (g->height / 2) - (text_h / 2);
-    else
-      text_y = 0;
-
-    fill(g, text_x, text_y, text_w, text_h, text_r, text_g, text_b);
-
-    sprintf(timebuf, "%02zu:%02zu", (size_t)minutes, (size_t)seconds);
-    stride = (text_x + 20) * g->pixel_size_in_bytes;
-    add_number_string(g, timebuf, stride , text_y + 20);
-  }
-
-beach:
-  g->frame++;
-  return 0;
+  g->audio_chunk++;
+  if (g->audio_deadline + g->audio_period < now) {
+    g->audio_deadline = now;
+  }
 }
 
-static int fill(video_generator* gen, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t r, uint8_t g, uint8_t b) {
+/*
+  Writes the frames [pos, pos + nframes) of the 4 second loop into
+  `dst` in `audio_format`. Everything outside the bip and bop is
+  silence, which is all zero bits for each of the formats. A chunk
+  can wrap around the end of the loop.
+*/
+static void synth_audio(video_generator* g, uint64_t pos, uint32_t nframes, uint8_t* dst) {
+
+  uint64_t loop = (uint64_t)g->audio_samplerate * g->audio_nseconds;
+  uint16_t frequency[2];
+  uint64_t start[2], end[2];
+  uint64_t p, a, b;
+  uint32_t done, n, i;
 
-  // Y
-  uint16_t yc = (uint16_t)(RGB2Y(r,g,b) * gen->pixel_factor);
-  uint16_t uc = (uint16_t)(RGB2U(r,g,b) * gen->pixel_factor);
-  uint16_t vc = (uint16_t)(RGB2V(r, g, b) * gen->pixel_factor);
-  uint32_t j, k, stride;
+  tone_window(g, 0, &start[0], &end[0]);
+  tone_window(g, 1, &start[1], &end[1]);
+  frequency[0] = g->audio_bip_frequency;
+  frequency[1] = g->audio_bop_frequency;
 
-  // UV
-  uint32_t xx = (uint32_t)(x * gen->u_factor);
-  uint32_t yy = (uint32_t)(y * gen->v_factor);
-  uint32_t half_w = (uint32_t)(gen->width * gen->u_factor);
-  uint32_t hh = (uint32_t)(h * gen->v_factor);
-  uint32_t ww = (uint32_t)(w * gen->u_factor);
+  memset(dst, 0x00, (size_t)nframes * g->audio_frame_bytes);
 
-  // y
-  for (j = y; j < (uint32_t)(y + h); ++j) {
-    stride = (j * gen->width + x) * gen->pixel_size_in_bytes;
-    if(gen->pixel_size_in_bytes == 2) {
-      for(k = 0; k < w * gen->pixel_size_in_bytes; k+=gen->pixel_size_in_bytes) {
-        gen->y[stride + k] = LSB(yc, gen->byte_order);
-        gen->y[stride + k + 1 ] = MSB(yc, gen->byte_order);
+  done = 0;
+  while (done < nframes) {
+    p = (pos + done) % loop;
+    n = (uint32_t)MIN((uint64_t)(nframes - done), loop - p);
+    for (i = 0; i < 2; ++i) {
+      a = MAX(p, start[i]);
+      b = MIN(p + n, end[i]);
+      if (a < b) {
+        synth_tone(g, dst + (size_t)(done + (a - p)) * g->audio_frame_bytes, frequency[i], a - start[i], (uint32_t)(b - a));
       }
-    } else {
-      memset(gen->y + j * gen->width + x, (uint8_t)yc,  w);
     }
+    done += n;
   }
+}
+
+/*
+  Writes `nframes` samples of a sine that started `offset` samples
+  ago. The phase is advanced with sin(x + 4w) = 2cos(4w)sin(x) - sin(x - 4w)
+  in four independent lanes that the compiler can vectorize. The lanes
+  are seeded with the exact phase at the start of every block, so the
+  error doesn't accumulate and the chunk boundaries don't show up in
+  the signal. The mono block is then converted into each channel.
+*/
+static void synth_tone(video_generator* g, uint8_t* dst, uint16_t frequency, uint64_t offset, uint32_t nframes) {
+
+  double w = (6.28318530718 / g->audio_samplerate) * frequency;
+  double c = 2.0 * cos(4.0 * w);
+  double block[RXS_SYNTH_BLOCK];
+  double cur[4], prev[4], next;
+  uint32_t nch = g->audio_nchannels;
+  uint32_t done, n, i, j, k;
+  int16_t* s16 = (int16_t*)dst;
+  int32_t* s32 = (int32_t*)dst;
+  float* f32 = (float*)dst;
+
+  done = 0;
+  while (done < nframes) {
+
+    n = MIN(nframes - done, RXS_SYNTH_BLOCK);
 
-  // u and v
-  for (j = yy; j < (yy + hh); ++j) {
-    stride = (j * half_w + xx) * gen->pixel_size_in_bytes;
-    if (gen->pixel_size_in_bytes == 2) {
-      for(k = 0; k < ww * gen->pixel_size_in_bytes; k += gen->pixel_size_in_bytes) {
-         gen->u[stride + k] = LSB(uc, gen->byte_order);
-         gen->u[stride + k + 1] = MSB(uc, gen->byte_order);
-         gen->v[stride + k] = LSB(vc, gen->byte_order);
-         gen->v[stride + k + 1] = MSB(vc, gen->byte_order);
+    for (j = 0; j < 4; ++j) {
+      cur[j] = sin(w * (double)(offset + done + j));
+      prev[j] = sin(w * ((double)(offset + done + j) - 4.0));
+    }
+
+    for (i = 0; i < n; i += 4) {
+      for (j = 0; j < 4; ++j) {
+        block[i + j] = RXS_AUDIO_AMPLITUDE * cur[j];
+        next = c * cur[j] - prev[j];
+        prev[j] = cur[j];
+        cur[j] = next;
+      }
+    }
+
+    switch (g->audio_format) {
+      case VIDEO_GENERATOR_AUDIO_S32: {
+        for (i = 0; i < n; ++i) {
+          for (k = 0; k < nch; ++k) {
+            s32[(done + i) * nch + k] = (int32_t)(block[i] * 2147483647.0);
+          }
+        }
+        break;
+      }
+      case VIDEO_GENERATOR_AUDIO_F32: {
+        for (i = 0; i < n; ++i) {
+          for (k = 0; k < nch; ++k) {
+            f32[(done + i) * nch + k] = (float)block[i];
+          }
+        }
+        break;
+      }
+      default: {
+        for (i = 0; i < n; ++i) {
+          for (k = 0; k < nch; ++k) {
+            s16[(done + i) * nch + k] = (int16_t)(block[i] * 32768.0);
+          }
+        }
+        break;
       }
-    } else {
-      memset(gen->u + stride,  (uint8_t)uc, (ww));
-      memset(gen->v + stride,  (uint8_t)vc, (ww));
     }
+
+    done += n;
   }
+}
 
-  return 0;
+/*
+  Writes `nframes` frames of `src` into the ring. This is only called
+  by the audio thread (or by `update()` in offline mode); the frames
+  only become visible to the reader when `audio_ring_write` is
+  updated. When the reader doesn't keep up we drop the complete chunk.
+*/
+static void ring_write(video_generator* g, const uint8_t* src, uint32_t nframes) {
+
+  uint64_t w = g->audio_ring_write;
+  uint64_t r = ATOMIC_LOAD64(&g->audio_ring_read);
+  size_t fb = g->audio_frame_bytes;
+  uint32_t mask = g->audio_ring_frames - 1;
+  uint32_t pos, n;
+
+  if (g->audio_ring_frames - (w - r) < (uint64_t)nframes) {
+    ATOMIC_STORE64(&g->audio_overruns, g->audio_overruns + nframes);
+    return;
+  }
+
+  pos = (uint32_t)(w & mask);
+  n = MIN(nframes, g->audio_ring_frames - pos);
+  memcpy(g->audio_ring + pos * fb, src, n * fb);
+  memcpy(g->audio_ring, src + n * fb, (nframes - n) * fb);
+
+  ATOMIC_STORE64(&g->audio_ring_write, w + nframes);
 }
 
-static int add_number_string(video_generator* gen, const char* str, uint32_t x, uint32_t y) {
+int video_generator_read_audio(video_generator* g, void* dst, uint32_t nframes) {
 
- video_generator_char* found_char = NULL;
- size_t len = strlen(str);
- size_t i = 0;
- int k = 0;
+  uint8_t* out = (uint8_t*)dst;
+  uint64_t r, w;
+  uint32_t mask, pos, avail, n, first;
+  size_t fb;
 
- for (i = 0; i < len; ++i) {
+  if (!g) { return -1; }
+  if (!dst) { return -2; }
+  if (NULL == g->audio_ring) { return -3; }
 
-   found_char = NULL;
+  fb = g->audio_frame_bytes;
+  mask = g->audio_ring_frames - 1;
+  r = g->audio_ring_read;
+  w = ATOMIC_LOAD64(&g->audio_ring_write);
+  avail = (uint32_t)(w - r);
+  n = MIN(nframes, avail);
 
-   for (k = 0; k < RXS_MAX_CHARS; ++k) {
-     if (gen->chars[k].id == str[i]) {
-       found_char = &gen->chars[k];
-       break;
-     }
-   }
+  pos = (uint32_t)(r & mask);
+  first = MIN(n, g->audio_ring_frames - pos);
+  memcpy(out, g->audio_ring + pos * fb, first * fb);
+  memcpy(out + first * fb, g->audio_ring, (n - first) * fb);
 
-   if (!found_char) {
-     printf("Error: Cannot find character: %c\n", str[i]);
-     continue;
-   }
+  /* whatever isn't available yet is played as silence. */
+  if (n < nframes) {
+    memset(out + n * fb, 0x00, (nframes - n) * fb);
+    ATOMIC_STORE64(&g->audio_underruns, g->audio_underruns + (nframes - n));
+  }
 
-   add_char(gen, found_char, x, y);
-   x += found_char->xadvance;
- }
+  ATOMIC_STORE64(&g->audio_ring_read, r + n);
 
- return 0;
+  return (int)n;
 }
 
-static int add_char(video_generator* gen, video_generator_char* kar, uint32_t x, uint32_t y) {
-  uint32_t i = 0;
-  uint32_t j = 0;
-  uint32_t dest_x = 0;
-  uint32_t dest_y = 0;
-  uint32_t src_dx = 0;
-  uint32_t dest_dx = 0;
+/*
+  Sleeps until the deadline of `g->frame`. The deadline is computed from
+  the start instead of the previous frame so late frames don't shift
+  the frames after them.
+*/
+int video_generator_wait_next_frame(video_generator* g) {
 
-  uint8_t* pixels = (uint8_t*)numbersfont_pixel_data;
+  video_generator_pacing* p;
+  uint64_t deadline, now;
 
-  if (!kar) { return -1; }
-  if (!gen) { return -2; }
+  if (!g) { return -1; }
+  if (!g->fps_den) { return -2; }
 
-  for (i = kar->x, dest_x = x; i < (kar->x + kar->width); ++i, ++dest_x) {
-    for (j = kar->y, dest_y = y; j < (kar->y + kar->height); ++j, ++dest_y) {
-      src_dx = j * gen->font_w + i;
-      dest_dx = (kar->yoffset + dest_y) * gen->width * gen->pixel_size_in_bytes + dest_x;
-      gen->y[dest_dx] = pixels[src_dx];
-    }
+  p = &g->pacing;
+  now = ns();
+  if (0 == g->pace_started) {
+    g->pace_started = 1;
+    g->pace_start_ns = now;
+    g->pace_start_frame = g->frame;
   }
 
+  deadline = g->pace_start_ns + ((g->frame - g->pace_start_frame) * 1000000000ull) / g->fps_den;
+  p->frames++;
+
+  if (now > deadline) {
+    p->late++;
+    p->late_max_ns = MAX(p->late_max_ns, now - deadline);
+    pacing_add(p, now - deadline);
+    return 1;
+  }
+
+  sleep_until(deadline);
+
+  now = ns();
+  now = (now > deadline) ? now - deadline : 0;
+  p->jitter_ns += now;
+  p->jitter_max_ns = MAX(p->jitter_max_ns, now);
+  pacing_add(p, now);
+
   return 0;
 }
 
-/* ----------------------------------------------------------------------------------- */
-/*                          A U D I O  G E N E R A T O R                               */
-/* ----------------------------------------------------------------------------------- */
-
-static void* audio_thread(void* gen) {
-  video_generator* g;
-  uint8_t must_stop;
-  uint64_t now, delay, timeout, dx, bip_start_dx, bip_end_dx, bop_start_dx, bop_end_dx;
-  size_t nbytes = 0;
-  uint8_t* tmp_buffer = NULL;
-  uint8_t* audio_buffer = NULL;
-  size_t bytes_to_end = 0;
-  size_t bytes_from_start = 0;
-  size_t bytes_needed = 0;
-  size_t bytes_total = 0;
-  uint8_t is_bip = 0;
-  uint8_t is_bop = 0;
-  uint8_t prev_is_bip = 0;
-  uint8_t prev_is_bop = 0;
-  uint16_t num_bip_frames = 0;
-  uint64_t num_bip_bytes = 0;
-  uint16_t num_bop_frames = 0;
-  uint64_t num_bop_bytes = 0;
+/* Adds a lateness to its histogram bin. */
+static void pacing_add(video_generator_pacing* p, uint64_t late) {
 
+  uint64_t us = late / 1000;
+  uint32_t bin = 0;
 
-  /* get the handle. */
-  must_stop = 0;
-  g = (video_generator*)gen;
-  if (NULL == g) {
-    printf("Not supposed to happen but the audio thread cannot get a handle to the generator.\n");
-    exit(1);
+  while (0 != us && bin < VIDEO_GENERATOR_PACING_BINS - 1) {
+    us >>= 1;
+    bin++;
   }
 
-  /* init */
-  now = 0;
-  timeout = 0;
-  dx = 0;
-  delay = (uint64_t)(g->audio_nsamples * ((double)1.0/g->audio_samplerate) * 1e9);
-  nbytes = g->audio_nsamples * sizeof(int16_t) * g->audio_nchannels;
-  tmp_buffer = (uint8_t*)malloc(nbytes);
-  audio_buffer = (uint8_t*)g->audio_buffer;
-  bytes_needed = nbytes;
-  bytes_total = g->audio_nbytes;
-
-  /* calc the bip/bop start and end positions. */
-  num_bip_frames =  (uint16_t)((g->audio_bip_millis/1000.0) * g->audio_samplerate);
-  num_bip_bytes = sizeof(int16_t) * g->audio_nchannels * num_bip_frames;
-  num_bop_frames =(uint16_t)((g->audio_bop_millis/1000.0) * g->audio_samplerate);
-  num_bop_bytes = sizeof(int16_t) * g->audio_nchannels * num_bop_frames;
-  bip_start_dx = (bytes_total / g->audio_nseconds);
-  bip_end_dx = bip_start_dx + num_bip_bytes;
-  bop_start_dx = ((bytes_total / g->audio_nseconds) * 3);
-  bop_end_dx = bop_start_dx + num_bop_bytes;
+  p->histogram[bin]++;
+}
 
-  while (1) {
+int video_generator_get_pacing(video_generator* g, video_generator_pacing* pacing) {
 
-    mutex_lock(&g->audio_mutex);
-      must_stop = g->audio_thread_must_stop;
-    mutex_unlock(&g->audio_mutex);
+  if (!g) { return -1; }
+  if (!pacing) { return -2; }
 
-    if (1 == must_stop) {
-      break;
-    }
+  memcpy(pacing, &g->pacing, sizeof(*pacing));
 
-    now = ns();
-    if (now > timeout) {
+  return 0;
+}
+
+/*
+  Copies the timings. The frame stages are only written by the thread
+  that renders, the audio members are written by the audio thread and
+  are read atomically.
+*/
+int video_generator_get_stats(video_generator* g, video_generator_stats* stats) {
 
-      /* Playing bip? */
-      is_bip = (dx >= bip_start_dx && dx <= bip_end_dx) ? 1 : 0;
-      is_bop = (dx >= bop_start_dx && dx <= bop_end_dx) ? 1 : 0;
+  video_generator_stats* s;
 
-      bytes_to_end = bytes_total - (size_t)dx;
-      if (0 == bytes_to_end) {
-        dx = 0;
-        bytes_to_end = bytes_total;
-      }
+  if (!g) { return -1; }
+  if (!stats) { return -2; }
+  if (0 == g->stats_enabled) { return -3; }
+
+  s = &g->stats;
+  stats->frames = s->frames;
+  memcpy(stats->stage_ns, s->stage_ns, sizeof(s->stage_ns));
+  memcpy(stats->last_stage_ns, s->last_stage_ns, sizeof(s->last_stage_ns));
+  stats->audio_callbacks = ATOMIC_LOAD64(&s->audio_callbacks);
+  stats->audio_callback_ns = ATOMIC_LOAD64(&s->audio_callback_ns);
+  stats->audio_callback_last_ns = ATOMIC_LOAD64(&s->audio_callback_last_ns);
+  stats->audio_callback_max_ns = ATOMIC_LOAD64(&s->audio_callback_max_ns);
+  stats->audio_wakeups = ATOMIC_LOAD64(&s->audio_wakeups);
+  stats->audio_jitter_ns = ATOMIC_LOAD64(&s->audio_jitter_ns);
+  stats->audio_jitter_last_ns = ATOMIC_LOAD64(&s->audio_jitter_last_ns);
+  stats->audio_jitter_max_ns = ATOMIC_LOAD64(&s->audio_jitter_max_ns);
+  stats->audio_late = ATOMIC_LOAD64(&s->audio_late);
 
-      if (bytes_to_end < bytes_needed) {
+  return 0;
+}
 
-        /* We need to read some bytes till the end, then from the start. */
-        memcpy(tmp_buffer, audio_buffer+dx, bytes_to_end-1);
+/* Records the time it took to deliver one chunk of audio, there is one writer: the audio thread or, offline, the render thread. */
+static void stats_audio_callback(video_generator* g, uint64_t duration) {
 
-        /* Read from the start. */
-        bytes_from_start = bytes_needed - bytes_to_end;
-        memcpy(tmp_buffer + bytes_to_end, audio_buffer, bytes_from_start);
-        g->audio_callback((int16_t*)tmp_buffer, nbytes, g->audio_nsamples);
+  video_generator_stats* s = &g->stats;
 
-        dx = bytes_from_start;
-      }
-      else {
-        /* We can read a complete chunk. */
-        g->audio_callback((int16_t*)(audio_buffer + dx), nbytes, g->audio_nsamples);
-        dx += nbytes;
-      }
+  ATOMIC_STORE64(&s->audio_callbacks, s->audio_callbacks + 1);
+  ATOMIC_STORE64(&s->audio_callback_ns, s->audio_callback_ns + duration);
+  ATOMIC_STORE64(&s->audio_callback_last_ns, duration);
+  if (duration > s->audio_callback_max_ns) {
+    ATOMIC_STORE64(&s->audio_callback_max_ns, duration);
+  }
+}
 
-      /* Update bip / bop flags. */
-      if (is_bip != prev_is_bip) {
-        mutex_lock(&g->audio_mutex);
-          g->audio_is_bip = is_bip;
-        mutex_unlock(&g->audio_mutex);
-      }
-      if (is_bop != prev_is_bop) {
-        mutex_lock(&g->audio_mutex);
-          g->audio_is_bop = is_bop;
-        mutex_unlock(&g->audio_mutex);
-      }
+/* Records how long after its deadline the audio thread woke up. */
+static void stats_audio_wakeup(video_generator* g, uint64_t jitter) {
 
-      timeout = now + delay;
-      prev_is_bip = is_bip;
-      prev_is_bop = is_bop;
-    }
+  video_generator_stats* s = &g->stats;
+
+  ATOMIC_STORE64(&s->audio_wakeups, s->audio_wakeups + 1);
+  ATOMIC_STORE64(&s->audio_jitter_ns, s->audio_jitter_ns + jitter);
+  ATOMIC_STORE64(&s->audio_jitter_last_ns, jitter);
+  if (jitter > s->audio_jitter_max_ns) {
+    ATOMIC_STORE64(&s->audio_jitter_max_ns, jitter);
   }
+}
 
-  free(tmp_buffer);
-  tmp_buffer = NULL;
+int video_generator_get_audio_counters(video_generator* g, uint64_t* overruns, uint64_t* underruns) {
 
-  return NULL;
+  if (!g) { return -1; }
+  if (NULL == g->audio_ring) { return -2; }
+
+  if (overruns) {
+    *overruns = ATOMIC_LOAD64(&g->audio_overruns);
+  }
+  if (underruns) {
+    *underruns = ATOMIC_LOAD64(&g->audio_underruns);
+  }
+
+  return 0;
+}
+
+/*
+  Offline mode: delivers the samples that cover the duration of frame
+  `g->frame`, i.e. [floor(n * samplerate / fps), floor((n + 1) * samplerate / fps)).
+  The number of samples per frame varies when the samplerate isn't a
+  multiple of the framerate but the total never drifts. The bip/bop
+  flags are set when the samples of the frame overlap them, so the
+  output only depends on the frame number.
+*/
+static void offline_audio(video_generator* g) {
+
+  uint64_t start = (g->frame * g->audio_samplerate) / g->fps_den;
+  uint64_t end = ((g->frame + 1) * g->audio_samplerate) / g->fps_den;
+  uint32_t nframes = (uint32_t)(end - start);
+  uint8_t is_bip, is_bop;
+
+  frame_bip_bop(g, g->frame, &is_bip, &is_bop);
+  ATOMIC_STORE8(&g->audio_is_bip, is_bip);
+  ATOMIC_STORE8(&g->audio_is_bop, is_bop);
+
+  /* `audio_buffer` fits the samples of the longest frame, see `video_generator_init()`. */
+  synth_audio(g, start, nframes, g->audio_buffer);
+
+  if (NULL != g->audio_callback) {
+    uint64_t t = (1 == g->stats_enabled) ? ns() : 0;
+    g->audio_callback((const int16_t*)g->audio_buffer, (uint64_t)nframes * g->audio_frame_bytes, nframes);
+    if (1 == g->stats_enabled) {
+      stats_audio_callback(g, ns() - t);
+    }
+  }
+  else {
+    ring_write(g, g->audio_buffer, nframes);
+  }
 }
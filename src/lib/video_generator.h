@@ -28,7 +28,8 @@
   time is based on the generated number of video frames. It's up to
   the user to make sure that the `video_generator_update()` function
   is called often enough to keep up with the number of frames you want
-  to generate.
+  to generate, `video_generator_wait_next_frame()` can do the pacing
+  for you.
 
 
   Using the Video Generator
@@ -39,18 +40,310 @@
   new video frame. When you call `video_generator_update()` the
   `frame` member of the `video_generator` struct is updated. Each time
   you call `video_generator_update()` it will update the contents of
-  the Y, U, and V planes. When you're using audio it will call the
-  audio callback at the right intervals to simulate a audio-capture
-  callback. When ready clean memory using `video_generator_clear()`.
+  the Y, U, and V planes. The static background is rendered once at
+  init and only the regions that change between two frames are
+  repainted, so treat the planes as read-only. When you're using
+  audio it will call the audio callback at the right intervals to
+  simulate a audio-capture callback. When ready clean memory using
+  `video_generator_clear()`.
 
   IMPORTANT: when you use audio, note that the callback is called from
              a separate thread, just like a normal audio capture
              callback would do. Do not peform heavy tasks in this
              callback!
 
-  video_generator_init()       - initialize, see below for the declaration.
-  video_generator_update()     - generate a new video frame, see below for the declaration.
-  video_generator_clear()      - frees allocated memory, see below for the declaration.
+  video_generator_init()           - initialize, see below for the declaration.
+  video_generator_update()         - generate a new video frame, see below for the declaration.
+  video_generator_update_into()    - generate a new video frame into your own planes.
+  video_generator_acquire_frame()  - generate a new video frame into a buffer of the frame pool.
+  video_generator_release_frame()  - give a frame pool buffer back to the generator.
+  video_generator_clear()          - frees allocated memory, see below for the declaration.
+
+
+  Using the frame pool
+  --------------------
+
+  When you set `pool_size` the generator allocates that many extra
+  frame buffers. `video_generator_acquire_frame()` renders the next
+  frame into a free buffer and hands it to you; the buffer is not
+  touched again until you pass it to `video_generator_release_frame()`.
+  This lets you keep a frame around (e.g. while an encoder thread is
+  working on it) without copying it. Acquire returns -4 when all
+  buffers are in use. Releasing may be done from any thread, acquiring
+  and updating must happen on one thread at a time.
+
+  `video_generator_update_n()` renders several frames in one call:
+  pass an array of `n` entries, NULL entries get a pool buffer (all or
+  none, -4 when there aren't enough) and the others are your own
+  buffers with the layout of `y`, `u` and `v`. The frames are prepared
+  one after the other and then drawn together, so with `nthreads` the
+  render threads work on several small frames at once instead of
+  splitting one frame that is too small to split. All frame ids of a
+  call have the same time stamp.
+
+
+  Rendering into your own planes
+  ------------------------------
+
+  `video_generator_update_into()` renders the next frame straight into
+  planes that you allocated, e.g. the padded and aligned surfaces of a
+  hardware encoder or separately mapped DMA buffers. You pass a base
+  pointer and a stride in bytes for each plane; the stride must be at
+  least the row size of the plane and the planes don't have to be
+  aligned or adjacent. It advances the generator like
+  `video_generator_update()` but always draws the complete frame,
+  because it can't know what is left in your buffers. With format 400
+  the u and v planes are ignored, with VIDEO_GENERATOR_FORMAT_NV12 the
+  v plane is.
+
+
+  Random access
+  -------------
+
+  `video_generator_render_frame()` renders any frame number into your
+  own y, u and v planes (with the same layout as `y`, `u` and `v`).
+  It computes everything from the frame number and doesn't change the
+  generator, so several threads (or machines) can each render a part
+  of a clip. The result is identical to what `video_generator_update()`
+  produces for that frame when there is no audio or the audio is in
+  offline mode; with a realtime audio thread the bip/bop colors are
+  derived from the frame number like offline mode does.
+
+
+  Audio
+  -----
+
+  The samples are synthesized when they're delivered, one chunk at a
+  time, so the memory that is used for audio doesn't depend on the
+  samplerate or the number of channels beyond one chunk. A tone is
+  computed from its position in the 4 second loop, which means that
+  the callback, pull and offline modes produce exactly the same
+  sample stream.
+
+  The audio thread delivers a chunk of `audio_nsamples` frames (1024
+  by default) every `audio_nsamples / samplerate` seconds; use small
+  periods of 64 - 256 frames to test low latency encoders and 4096 or
+  more for batching. Small periods need a thread that wakes up on
+  time, set `audio_realtime` to run it with SCHED_FIFO (or MMCSS "Pro
+  Audio" on Windows). When that isn't permitted the thread keeps its
+  normal priority and `audio_realtime` of the generator is 0. A chunk
+  is late when it's handed over after the next one was due; each late
+  chunk is passed to `audio_late_callback`.
+
+
+  Pulling audio
+  -------------
+
+  By default the audio thread calls `audio_callback` with chunks of
+  `audio_nsamples` frames. When you set `audio_mode` to
+  VIDEO_GENERATOR_AUDIO_PULL the audio thread writes the same samples
+  into a lock-free ring instead and you read them at your own cadence
+  with `video_generator_read_audio()`. There must be one reader only.
+  When you don't read fast enough the newest chunks are dropped and
+  counted as overruns; when you read more than is available the rest
+  of your buffer is filled with silence and counted as underruns, see
+  `video_generator_get_audio_counters()`.
+
+
+  Offline audio
+  -------------
+
+  With `audio_mode` VIDEO_GENERATOR_AUDIO_OFFLINE there is no audio
+  thread. Every frame that is rendered (by `video_generator_update()`
+  or `video_generator_acquire_frame()`) first delivers the samples
+  [floor(n * samplerate / fps), floor((n + 1) * samplerate / fps)) of frame n,
+  from the calling thread: to `audio_callback` when it's set otherwise
+  into the ring that you read with `video_generator_read_audio()`. The
+  bip/bop colors of the time box are derived from the same samples.
+  Nothing is paced by the clock so you can generate files as fast as
+  the cpu allows and the output is the same for each run.
+
+
+  Cycle cache
+  -----------
+
+  Some output repeats: with `onecolor` there are 7 distinct frames and
+  with `no_timestamp` the bar sweeps through the same `5 * fps` frames
+  over and over. When you also set `cycle_cache` the init renders one
+  cycle into memory (which can be a lot: 125 frames of 3MB for 1080p
+  at 25 fps) and every update is a single copy of a cached frame. With
+  `video_generator_next_cached()` you get a pointer to the cached
+  frame instead of a copy, fast enough to feed a sink that can take
+  tens of gigabytes per second. Init fails with -15 when `cycle_cache`
+  is set for content that doesn't repeat.
+
+
+  Frame id
+  --------
+
+  The `MM:SS` time stamp is only accurate to a second. When you set
+  `frame_id` each frame also gets a block code in the top left corner
+  of the y-plane that holds the frame number and the `ns()` time at
+  which the frame was rendered. The code is a grid of 16 x 9 blocks of
+  8 x 8 pixels, black for 0 and white for 1, read row by row. It holds
+  the frame number and the time stamp as 64 bit big endian values
+  followed by a CRC-16 (CCITT, polynomial 0x1021, initial value
+  0xffff) of those 16 bytes. The blocks are large enough to survive
+  lossy encoding, so after decoding you can use
+  `video_generator_read_frame_id()` to recover both values and measure
+  latency or find dropped and repeated frames. The frame must be at
+  least 128 x 72, init fails with -17 otherwise, and the code is read
+  at the original size and position. Because every frame is different
+  `frame_id` can't be combined with `cycle_cache`.
+
+
+  Stress patterns
+  ---------------
+
+  The bars compress extremely well, which makes them useless to push
+  an encoder or a link to its limits. Set `pattern` to replace the
+  bars with content that is expensive to encode; the text box and the
+  frame id are still drawn on top of it.
+
+     VIDEO_GENERATOR_PATTERN_NOISE     - new uniform noise in every plane for every frame.
+     VIDEO_GENERATOR_PATTERN_GRADIENT  - a textured gradient that moves 4 pixels right and
+                                         2 down per frame, so motion search has something to find.
+     VIDEO_GENERATOR_PATTERN_ZONEPLATE - a moving zone plate that sweeps all spatial frequencies
+                                         up to the sample rate at the edges, for scalers and filters.
+
+  The noise comes from a counter-based generator: every 32 bits are a
+  hash of their position in the frame, the frame number and `seed`.
+  The same seed gives the same frames no matter how many threads
+  render them or which kernels are used, and the rows cost the same
+  in any order. All patterns are rendered by vectorized kernels and
+  keep up with 4K60 on one core. Init fails with -18 for an unknown
+  pattern or when one is combined with `onecolor` or `cycle_cache`.
+
+
+  Timing
+  ------
+
+  Set `stats` to let the generator time itself. For every frame that
+  `video_generator_update()`, `video_generator_update_into()` or
+  `video_generator_acquire_frame()` renders it measures each
+  VIDEO_GENERATOR_STAGE_* with `ns()`; when several render threads
+  draw a frame the stage times are summed over the threads while
+  VIDEO_GENERATOR_STAGE_FRAME is the wall clock time. The audio thread
+  records how long each chunk took to deliver, how late it woke up
+  and how often a chunk was handed over after the next one was already
+  due. Read everything with `video_generator_get_stats()`; the frame
+  timings are written by the thread that renders, so read them from
+  that thread too, the audio timings may be read from any thread.
+  Without `stats` nothing is measured.
+
+
+  Pacing
+  ------
+
+  Call `video_generator_wait_next_frame()` before each update to
+  produce frames in realtime. It sleeps until the absolute deadline of
+  the next frame, so the rate doesn't drift: the clock starts at the
+  first call and frame N is due N / fps seconds after the frame of the
+  first call. A frame whose deadline already passed isn't skipped, the
+  function returns 1 right away so you catch up. Every call records
+  how late it returned in `video_generator_get_pacing()`: the number
+  of late frames and the maximum lateness, the wake up jitter of the
+  frames that were on time and a histogram of the lateness of all
+  frames with bins of powers of two microseconds.
+
+  Renditions
+  ----------
+
+  To test an ABR ladder you want the same content at several sizes
+  (and bit depths or formats). `video_generator_multi_init()` takes
+  an array of up to RXS_MAX_RENDITIONS settings and initializes one
+  generator per rendition in `renditions`; they all need the same
+  `fps` and can't use the cycle cache. `video_generator_multi_update()`
+  renders the next frame of every rendition: the bars, the time stamp,
+  the bips and bops and the frame id are the same in each so you can
+  switch between the renditions at any frame. The renditions share one
+  timeline and one set of render threads (`nthreads` of
+  `video_generator_multi_init()`, the `nthreads` of the settings is
+  ignored); the bands of all renditions are shared out over the
+  threads together. Only the first rendition has audio. Use
+  `video_generator_wait_next_frame()` and the other functions of a
+  single generator on `renditions[0]` for the pacing, audio and
+  stats, read the frames from `renditions[i].y`, `.u` and `.v`.
+
+  Memory
+  ------
+
+  All frame buffers (the frame, the background, the pool and the cycle
+  cache) start at a page boundary, and so does the y-plane; the u and v
+  planes follow at `ybytes` and `ybytes + ubytes`. Large frames can use
+  `alloc_flags` to control where the memory comes from:
+
+     VIDEO_GENERATOR_ALLOC_HUGEPAGES - round the buffers up to 2 MB and back them with huge pages:
+                                       explicit ones (MAP_HUGETLB, MEM_LARGE_PAGES) when the system
+                                       has them reserved, transparent huge pages otherwise.
+     VIDEO_GENERATOR_ALLOC_NUMA      - bind the buffers to `numa_node` and run the render threads
+                                       on its cpus. Pass the thread that calls `video_generator_update()`
+                                       to the same node yourself. Init fails with -19 when the node
+                                       doesn't exist; it's supported on Linux and Windows.
+     VIDEO_GENERATOR_ALLOC_PREFAULT  - write every page at init so the first frames don't stall on
+                                       page faults, and the pages are placed before rendering starts.
+
+  Huge pages are best effort: when none are available the buffers use
+  normal pages.
+
+
+  Shared memory ring
+  ------------------
+
+  To hand the frames to other processes without copying them through
+  a pipe, `video_generator_shm_create()` creates a named shared memory
+  ring (`shm_open()`, the name starts with a slash, e.g. "/videogen";
+  a file mapping on Windows, e.g. "Local\\videogen") of `nslots` frame
+  slots. `video_generator_shm_update()` renders the next frame directly
+  into the next slot and publishes it. The ring starts with a
+  `video_generator_shm_header` that describes the frames (size, format,
+  plane offsets and strides) followed by the page aligned slots.
+
+  Any number of readers attach with `video_generator_shm_open()`,
+  which maps the ring read-only. The generator never waits for them:
+  frame `n` of the ring is in slot `n % nslots` until it's overwritten
+  `nslots` frames later. A reader gets the newest `n` from
+  `video_generator_shm_latest()`, points at a frame with
+  `video_generator_shm_peek()` (-4 when it was already overwritten)
+  and, once it's done with the pixels, calls `video_generator_shm_check()`
+  which fails when the generator started to overwrite the slot in the
+  meantime. Use more slots when your readers need more time per frame.
+  `video_generator_shm_close()` unmaps the ring, for the generator it
+  also removes the name.
+
+
+  Many generators
+  ---------------
+
+  Generators don't share any mutable state, so you can run many of
+  them in one process and from different threads; each generator is
+  used by one thread at a time. The font tables are decoded once, at
+  the first init, and all 8-bit generators use the same copy.
+
+  Error messages go to stdout by default. Call
+  `video_generator_set_log_callback()` to pass them to your own
+  logger; it's one callback for the whole process.
+
+  With many generators a thread per generator adds up: each has
+  `nthreads - 1` render threads and an audio thread. Create one
+  `video_generator_context` and set `context` in the settings of every
+  generator to share them instead:
+
+     video_generator_context ctx;
+     video_generator_context_init(4, 0, &ctx);   // 3 render threads + the calling thread.
+     cfg.context = &ctx;                         // `nthreads` and `audio_realtime` are ignored now.
+     video_generator_init(&cfg, &g0);
+     video_generator_init(&cfg, &g1);
+     ...
+     video_generator_clear(&g0);
+     video_generator_clear(&g1);
+     video_generator_context_clear(&ctx);        // -2 while a generator still uses it.
+
+  The render threads work on one frame at a time: when two threads
+  update generators of the same context, one waits for the other. The
+  audio of all generators is delivered by the timer thread of the
+  context, so keep the audio callbacks short. Offline audio doesn't
+  use it. Clear all generators before the context.
 
 
   Settings:
@@ -66,19 +359,55 @@
   bip_frequency    - the frequency that is used for the bip sound (e.g. 700).
   bop_frequency    - the frequency that is used for the bop sound (e.g. 1500).
   audio_callback   - set this t the audio callback that will receive the audio buffer.
+  audio_mode       - VIDEO_GENERATOR_AUDIO_CALLBACK (default), VIDEO_GENERATOR_AUDIO_PULL or
+                     VIDEO_GENERATOR_AUDIO_OFFLINE, in pull and offline mode no callback is needed.
+  pool_size        - number of frame buffers for `video_generator_acquire_frame()`, 0 disables the pool.
+  nthreads         - number of threads that render a frame in horizontal bands, 0 or 1 renders on the
+                     calling thread only. The calling thread is one of them, at most RXS_MAX_THREADS.
+  format           - 400, 420 (default), 422 or 444 planar, or VIDEO_GENERATOR_FORMAT_NV12 for one
+                     interleaved uv-plane after the y-plane (`v` is NULL and `vbytes` is 0 then).
+  bitdepth         - 8 (default), 10, 12 or 16. Samples above 8 bits take 2 bytes in `byte_order`; they're
+                     LSB aligned for the planar formats and MSB aligned (P010, P016) for the semi-planar one.
+  simd             - one of the VIDEO_GENERATOR_SIMD_* values, by default the best kernels for the
+                     cpu are selected at runtime. Init fails when a level is forced that isn't available.
+  stats            - set to 1 to time the render stages and the audio thread, see `video_generator_get_stats()`.
+  no_timestamp     - set to 1 to leave out the text box with the time stamp.
+  cycle_cache      - set to 1 to render all distinct frames at init and copy them from then on, see "Cycle cache".
+  frame_id         - set to 1 to draw the machine readable frame number and time stamp, see "Frame id".
+  pattern          - one of the VIDEO_GENERATOR_PATTERN_* values, the bars by default, see "Stress patterns".
+  seed             - the seed of VIDEO_GENERATOR_PATTERN_NOISE.
+  alloc_flags      - VIDEO_GENERATOR_ALLOC_* flags for the frame buffers, see "Memory".
+  numa_node        - the node that VIDEO_GENERATOR_ALLOC_NUMA uses.
+  context          - share the render and timer threads of a `video_generator_context`, see "Many generators".
+  audio_samplerate - samplerate of the audio, 44100 when 0.
+  audio_nchannels  - number of interleaved channels, 2 when 0 and at most RXS_MAX_AUDIO_CHANNELS. All
+                     channels carry the same signal.
+  audio_format     - VIDEO_GENERATOR_AUDIO_S16 (default), VIDEO_GENERATOR_AUDIO_S32 or VIDEO_GENERATOR_AUDIO_F32.
+  audio_nsamples   - number of frames per audio chunk, 1024 when 0 and at most RXS_MAX_AUDIO_PERIOD.
+  audio_realtime   - set to 1 to run the audio thread with realtime priority when the os permits it.
+  audio_late_callback - is called from the audio thread for every chunk that was delivered late.
 
   Specification
   ---------------
 
-  Audio: 2 channels interleaved
-         44100hz
-         int16
+  Audio: 2 channels interleaved (see `audio_nchannels`)
+         44100hz (see `audio_samplerate`)
+         int16 (see `audio_format`)
+         a 4 second loop with a `bip_frequency` tone at 1s and a
+         `bop_frequency` tone at 3s, each 100ms.
 
-  Video: YUV420P / I420P
+  Video: YUV420P / I420P (or 400, 422, 444 planar, see `format`)
          1 continuous block of memory
          y-stride = width
          u-stride = width / 2
          v-stride = width / 2
+         (multiplied by 2 for a `bitdepth` above 8)
+
+         NV12 / P010 / P016
+         y-stride  = width
+         uv-stride = width (u and v interleaved)
+
+         `video_generator_update_into()` uses your own planes and strides.
 
 
   Convert video / audio with avconv
@@ -124,7 +453,7 @@
           break;
         }
 
-        usleep(gen.fps);
+        video_generator_wait_next_frame(&gen);
      }
 
     fclose(fp);
@@ -138,6 +467,17 @@
 #define VIDEO_GENERATOR_H
 
 #define RXS_MAX_CHARS 11
+#define RXS_MAX_THREADS 64
+#define RXS_MAX_COLORS 10
+#define RXS_MAX_AUDIO_CHANNELS 16
+#define RXS_MAX_AUDIO_PERIOD 65536
+#define RXS_MAX_RENDITIONS 8
+#define RXS_MAX_SHM_SLOTS 64
+#define RXS_MAX_SHM_NAME 128
+#define RXS_ID_BLOCK 8                                   /* width and height of a block of the frame id. */
+#define RXS_ID_COLS 16                                   /* number of blocks per row of the frame id. */
+#define RXS_ID_ROWS 9                                    /* number of rows of the frame id, 144 bits. */
+#define RXS_ID_BYTES 18                                  /* frame number, time stamp and CRC-16 of the frame id. */
 #include <stdint.h>
 
 #if defined(__cplusplus)
@@ -152,8 +492,10 @@ extern "C" {
 
   struct thread;                                                 /* Forward declared. */
   struct mutex;                                                  /* Forward declared. */
+  struct cond;                                                   /* Forward declared. */
   typedef struct thread thread;
   typedef struct mutex mutex;
+  typedef struct cond cond;
   typedef void*(*thread_function)(void* param);                  /* The thread function you need to write. */
 
   thread* thread_alloc(thread_function func, void* param);       /* Create a new thread handle. Don't forget to call thread_free(). */
@@ -163,6 +505,12 @@ extern "C" {
   int mutex_destroy(mutex* m);                                   /* Destroy the mutex. */
   int mutex_lock(mutex* m);                                      /* Lock the mutex. */
   int mutex_unlock(mutex* m);                                    /* Unlock the mutex. */
+  int cond_init(cond* c);                                        /* Initialize a condition variable. */
+  int cond_destroy(cond* c);                                     /* Destroy the condition variable. */
+  int cond_wait(cond* c, mutex* m);                              /* Wait until signalled, `m` must be locked. */
+  int cond_signal(cond* c);                                      /* Wake up one waiting thread. */
+  int cond_broadcast(cond* c);                                   /* Wake up all waiting threads. */
+  int thread_set_realtime(void);                                 /* Give the calling thread realtime priority, returns 0 on success. */
 
   /* ------------------------------------------------------------------------- */
 
@@ -180,7 +528,11 @@ extern "C" {
     };
 
     struct mutex {
-      HANDLE handle;
+      CRITICAL_SECTION handle;
+    };
+
+    struct cond {
+      CONDITION_VARIABLE handle;
     };
 
     DWORD WINAPI thread_wrapper_function(LPVOID param);
@@ -201,6 +553,10 @@ extern "C" {
       pthread_mutex_t handle;
     };
 
+    struct cond {
+      pthread_cond_t handle;
+    };
+
     void* thread_function_wrapper(void* t);
 
 #endif
@@ -208,6 +564,44 @@ extern "C" {
 #define BYTE_ORDER_LITTLE_ENDIAN 0
 #define BYTE_ORDER_BIG_ENDIAN    1
 
+#define VIDEO_GENERATOR_FORMAT_NV12 12                   /* 4:2:0 with one interleaved uv-plane: NV12 with a bitdepth of 8, P010 / P016 with 10 / 16. */
+
+#define VIDEO_GENERATOR_SIMD_AUTO 0                      /* use the best kernels the cpu supports. */
+#define VIDEO_GENERATOR_SIMD_NONE 1                      /* plain C kernels. */
+#define VIDEO_GENERATOR_SIMD_SSE2 2
+#define VIDEO_GENERATOR_SIMD_AVX2 3
+#define VIDEO_GENERATOR_SIMD_NEON 4
+
+#define VIDEO_GENERATOR_PATTERN_BARS 0                    /* the moving bar over the 7-bar background. */
+#define VIDEO_GENERATOR_PATTERN_NOISE 1                   /* uniform noise that is different for every frame. */
+#define VIDEO_GENERATOR_PATTERN_GRADIENT 2                /* a moving textured gradient. */
+#define VIDEO_GENERATOR_PATTERN_ZONEPLATE 3               /* a moving zone plate. */
+
+#define VIDEO_GENERATOR_ALLOC_HUGEPAGES 0x01              /* back the frame buffers with huge pages when the system can. */
+#define VIDEO_GENERATOR_ALLOC_NUMA 0x02                   /* allocate the frame buffers on `numa_node` and run the render threads on its cpus. */
+#define VIDEO_GENERATOR_ALLOC_PREFAULT 0x04               /* touch every page of the frame buffers at init. */
+
+#define VIDEO_GENERATOR_AUDIO_CALLBACK 0                 /* the audio thread passes the samples to `audio_callback`. */
+#define VIDEO_GENERATOR_AUDIO_PULL 1                     /* the audio thread writes into a ring, see `video_generator_read_audio()`. */
+#define VIDEO_GENERATOR_AUDIO_OFFLINE 2                  /* no audio thread, each rendered frame delivers the samples of its duration. */
+
+#define VIDEO_GENERATOR_SHM_MAGIC 0x52534756            /* "VGSR", the first bytes of a shared memory frame ring. */
+#define VIDEO_GENERATOR_SHM_VERSION 1                    /* is changed when the layout of `video_generator_shm_header` changes. */
+
+#define VIDEO_GENERATOR_AUDIO_S16 0                      /* signed 16 bit samples. */
+#define VIDEO_GENERATOR_AUDIO_S32 1                      /* signed 32 bit samples. */
+#define VIDEO_GENERATOR_AUDIO_F32 2                      /* 32 bit float samples in [-1, 1]. */
+
+#define VIDEO_GENERATOR_STAGE_RESET 0                    /* restoring the rows of the previous frame from the background. */
+#define VIDEO_GENERATOR_STAGE_BACKGROUND 1               /* filling the complete frame with one color (`onecolor`). */
+#define VIDEO_GENERATOR_STAGE_BAR 2                      /* drawing the moving bar. */
+#define VIDEO_GENERATOR_STAGE_TEXT 3                     /* copying the text box and drawing the frame id into the frame. */
+#define VIDEO_GENERATOR_STAGE_GLYPHS 4                   /* rendering the time stamp glyphs into the text box, about once a second. */
+#define VIDEO_GENERATOR_STAGE_FRAME 5                    /* wall clock time of the complete frame. */
+#define VIDEO_GENERATOR_NUM_STAGES 6
+
+#define VIDEO_GENERATOR_PACING_BINS 16                   /* bin 0 is < 1us, bin i is [2^(i-1), 2^i) us, the last bin holds the rest. */
+
 /* ----------------------------------------------------------------------------------- */
 /*                          V I D E O   G E N E R A T O  R                             */
 /* ----------------------------------------------------------------------------------- */
@@ -215,6 +609,18 @@ extern "C" {
 typedef struct video_generator video_generator;
 typedef struct video_generator_settings video_generator_settings;
 typedef struct video_generator_char video_generator_char;
+typedef struct video_generator_dirty video_generator_dirty;
+typedef struct video_generator_frame video_generator_frame;
+typedef struct video_generator_workers video_generator_workers;   /* Render threads, private to video_generator.c */
+typedef struct video_generator_kernels video_generator_kernels;   /* Format specific render functions, private to video_generator.c */
+typedef struct video_generator_color video_generator_color;
+typedef struct video_generator_stats video_generator_stats;
+typedef struct video_generator_pacing video_generator_pacing;
+typedef struct video_generator_multi video_generator_multi;
+typedef struct video_generator_shm_header video_generator_shm_header;
+typedef struct video_generator_shm video_generator_shm;
+typedef struct video_generator_multi_jobs video_generator_multi_jobs; /* Per frame state of the renditions, private to video_generator.c */
+typedef struct video_generator_context video_generator_context;
 
 /*
    When we generate audio we do this from a separate thread to make sure we
@@ -225,12 +631,32 @@ typedef struct video_generator_char video_generator_char;
    Make sure that you don't do too much in the callback because we need to keep up
    with the samplerate.
 
-   @param samples        The samples that you need to process.
+   @param samples        The samples that you need to process. They're interleaved and in
+                         `audio_format`, cast them to `int32_t` or `float` for S32 and F32.
    @param nbytes         The number of bytes in `samples`
    @param nframes        The number of frames in `samples`.
 */
 typedef void(*video_generator_audio_callback)(const int16_t* samples, uint64_t nbytes, uint32_t nframes);
 
+/*
+   Called from the audio thread when a chunk was handed over after the
+   next chunk was due.
+
+   @param chunk          The index of the chunk, the first chunk is 0.
+   @param late_ns        How long after the deadline of the next chunk it was delivered.
+*/
+typedef void(*video_generator_audio_late_callback)(uint64_t chunk, uint64_t late_ns);
+
+/*
+   Receives the error messages of all generators in the process, see
+   `video_generator_set_log_callback()`. It can be called from any
+   thread, also from several threads at the same time.
+
+   @param user           The pointer you passed with the callback.
+   @param message        One line of text without a newline.
+*/
+typedef void(*video_generator_log_callback)(void* user, const char* message);
+
 struct video_generator_char {
   char id;
   uint32_t x;
@@ -240,6 +666,60 @@ struct video_generator_char {
   uint32_t xoffset;
   uint32_t yoffset;
   uint32_t xadvance;
+  uint32_t offset;                                        /* byte offset of the converted glyph in `glyphs`. */
+};
+
+/* A color as y, u and v samples in the output bitdepth and byte order. */
+struct video_generator_color {
+  uint16_t y;
+  uint16_t u;
+  uint16_t v;
+  uint32_t uv;                                            /* u followed by v as they're stored in an interleaved chroma plane. */
+};
+
+/* Which part of a frame buffer differs from the static background. */
+struct video_generator_dirty {
+  uint8_t  restored;                                      /* is set to 1 once the background has been copied into the buffer. */
+  uint32_t y;                                             /* first y-plane row of the moving bar in the previous frame. */
+  uint32_t h;                                             /* number of y-plane rows of the moving bar in the previous frame. */
+  uint32_t uv_y;                                          /* first u/v-plane row of the moving bar in the previous frame. */
+  uint32_t uv_h;                                          /* number of u/v-plane rows of the moving bar in the previous frame. */
+};
+
+/* A frame buffer of the frame pool, see `video_generator_acquire_frame()`. */
+struct video_generator_frame {
+  uint64_t frame;                                         /* the frame number that was rendered into this buffer. */
+  uint8_t* y;                                             /* points to the y-plane. */
+  uint8_t* u;                                             /* points to the u-plane, or the interleaved uv-plane. */
+  uint8_t* v;                                             /* points to the v-plane, NULL for the semi-planar formats. */
+  uint8_t  in_use;                                        /* is set to 1 between acquire and release. */
+  video_generator_dirty dirty;                            /* used to only repaint what changed since the previous use of this buffer. */
+};
+
+/* Timings of the generator, see `video_generator_get_stats()`. All times are in nanoseconds. */
+struct video_generator_stats {
+  uint64_t frames;                                        /* number of frames that were timed. */
+  uint64_t stage_ns[VIDEO_GENERATOR_NUM_STAGES];          /* cumulative time per VIDEO_GENERATOR_STAGE_*. */
+  uint64_t last_stage_ns[VIDEO_GENERATOR_NUM_STAGES];     /* time per stage of the last frame. */
+  uint64_t audio_callbacks;                               /* number of audio chunks that were delivered. */
+  uint64_t audio_callback_ns;                             /* cumulative time spent in `audio_callback` (or writing the ring in pull mode). */
+  uint64_t audio_callback_last_ns;
+  uint64_t audio_callback_max_ns;
+  uint64_t audio_wakeups;                                 /* number of times the audio thread woke up for a chunk. */
+  uint64_t audio_jitter_ns;                               /* cumulative time the audio thread woke up after its deadline. */
+  uint64_t audio_jitter_last_ns;
+  uint64_t audio_jitter_max_ns;
+  uint64_t audio_late;                                    /* number of chunks that were delivered after the deadline of the next chunk. */
+};
+
+/* How well `video_generator_wait_next_frame()` kept up, all times are in nanoseconds. */
+struct video_generator_pacing {
+  uint64_t frames;                                        /* number of calls. */
+  uint64_t late;                                          /* number of frames whose deadline had passed before the call. */
+  uint64_t late_max_ns;                                   /* how late the latest of these frames was. */
+  uint64_t jitter_ns;                                     /* cumulative time the frames that were on time woke up after their deadline. */
+  uint64_t jitter_max_ns;
+  uint64_t histogram[VIDEO_GENERATOR_PACING_BINS];        /* number of frames per lateness bin, see VIDEO_GENERATOR_PACING_BINS. */
 };
 
 struct video_generator_settings {
@@ -253,6 +733,25 @@ struct video_generator_settings {
   uint16_t bip_frequency;
   uint16_t bop_frequency;
   video_generator_audio_callback audio_callback;
+  uint8_t  audio_mode;
+  uint32_t audio_samplerate;
+  uint16_t audio_nchannels;
+  uint8_t  audio_format;
+  uint32_t audio_nsamples;
+  uint8_t  audio_realtime;
+  video_generator_audio_late_callback audio_late_callback;
+  uint32_t pool_size;
+  uint32_t nthreads;
+  uint8_t  simd;
+  uint8_t  stats;
+  uint8_t  no_timestamp;
+  uint8_t  cycle_cache;
+  uint8_t  frame_id;
+  uint8_t  pattern;
+  uint32_t seed;
+  uint8_t  alloc_flags;
+  uint32_t numa_node;
+  video_generator_context* context;
 };
 
 struct video_generator {
@@ -270,42 +769,193 @@ struct video_generator {
   uint32_t nbytes;                                        /* total number of bytes in the allocated buffer for the yuv420p buffer. */
   double   u_factor;                                      /* Provide a factor to change the colorspace*/
   double   v_factor;                                      /* Provide a factor to change the colorspace*/
+  uint32_t uv_width;                                      /* width of the u and v planes. */
+  uint32_t uv_height;                                     /* height of the u and v planes. */
+  uint8_t  uv_shift_x;                                    /* x >> uv_shift_x gives the column in the u and v planes. */
+  uint8_t  uv_shift_y;                                    /* y >> uv_shift_y gives the row in the u and v planes. */
+  uint8_t  uv_interleaved;                                /* 1 when u and v are interleaved in one plane (NV12, P010, P016), `v` is NULL then. */
   uint8_t  pixel_size_in_bytes;                           /* Size of the word to express the pixel 8bits = 1 byte 16 bits = 2 bytes*/
-  uint8_t  pixel_factor;                                  /* pixel factor to convert from 8 bits to 10 or 12 bits*/
+  uint16_t pixel_factor;                                  /* pixel factor to convert from 8 bits to 10, 12 or 16 bits, or to MSB aligned samples. */
   uint8_t  byte_order;                                    /* byte order or endinness for the LSB and MSB, 0 for little endian*/
+  uint32_t format;                                        /* 400, 420, 422, 444 or VIDEO_GENERATOR_FORMAT_NV12. */
+  uint8_t  bitdepth;                                      /* 8, 10, 12 or 16. */
   uint32_t fps_num;                                       /* framerate numerator e.g. 1. */
   uint32_t fps_den;                                       /* framerate denominator e.g. 25. */
   double fps;                                             /* framerate in microseconds, 1 fps == 1.000.000 us. */
   double step;                                            /* used to create/translate the moving bar. */
   double perc;                                            /* position of the moving bar in percentages. */
+  double* perc_table;                                     /* the values of `perc` for one cycle of the bar, used by `video_generator_render_frame()`. */
+  uint32_t perc_cycle;                                    /* number of frames after which the bar starts at the top again. */
   video_generator_char chars[RXS_MAX_CHARS];              /* bitmap characters, `0-9` and `:` */
   uint32_t font_w;                                        /* width of the bitmap (which is stored in video_generator.c). */
   uint32_t font_h;                                        /* height of the bitmap (which is stored in video_generator.c). */
   uint32_t font_line_height;
+  uint8_t* glyphs;                                        /* all characters converted into samples of the output bitdepth and byte order, row by row. */
+  uint8_t* text_box;                                      /* the composited `MM:SS` box, y rows followed by the u and v rows. */
+  uint32_t text_box_key;                                  /* time and color that `text_box` was rendered for, 0 when it's not rendered yet. */
   uint8_t onecolor;                                       /* Generate only one color*/
+  uint8_t  no_timestamp;                                  /* 1 when the text box with the time stamp isn't drawn. */
+  uint8_t  frame_id;                                      /* 1 when the frame number and time stamp are drawn as a block code. */
+  video_generator_color id_colors[2];                     /* the colors of a 0 and a 1 block of the frame id. */
+  uint8_t* cycle;                                         /* `cycle_frames` complete frames of `nbytes` each when the cycle cache is used. */
+  uint32_t cycle_frames;                                  /* number of frames after which the output repeats, 0 without the cycle cache. */
+  uint8_t* bg;                                            /* the static 7-bar background, rendered once by `video_generator_init()`, NULL with a pattern. */
+  uint8_t  pattern;                                       /* one of the VIDEO_GENERATOR_PATTERN_* values. */
+  uint32_t seed;                                          /* seed of the noise pattern. */
+  uint8_t  alloc_flags;                                   /* the VIDEO_GENERATOR_ALLOC_* flags of the frame buffers. */
+  uint32_t numa_node;                                     /* the node of the buffers and render threads with VIDEO_GENERATOR_ALLOC_NUMA. */
+  uint32_t noise_mask;                                    /* clears the bits of two noise samples that are outside the bitdepth. */
+  uint16_t* zone_phase;                                   /* x^2 term of the zone plate phase for each y column, followed by the uv columns. */
+  uint8_t  pattern_swap;                                  /* 1 when the bytes of the 16-bit pattern samples are swapped for the output byte order. */
+  video_generator_dirty dirty;                            /* what changed in the y, u and v planes. */
+  video_generator_frame* pool;                            /* the frame buffers used by `video_generator_acquire_frame()`. */
+  uint32_t pool_size;                                     /* number of buffers in `pool`. */
+  mutex pool_mutex;                                       /* protects the `in_use` members of the pool. */
+  uint32_t nthreads;                                      /* number of threads that render a frame, including the calling thread. */
+  uint8_t  simd;                                          /* the VIDEO_GENERATOR_SIMD_* level of the kernels that are used. */
+  void(*fill16)(uint8_t* dst, uint16_t sample, uint32_t nsamples); /* fills a row with a 16-bit sample that is already in the output byte order. */
+  void(*fill32)(uint8_t* dst, uint32_t sample, uint32_t nsamples); /* fills a row with a 32-bit pattern, used for interleaved 16-bit u and v samples. */
+  void(*noise)(uint8_t* dst, uint32_t nbytes, uint32_t counter, uint32_t key, uint32_t mask); /* fills `nbytes` with the hash of consecutive counters. */
+  void(*gradient)(uint8_t* dst, uint32_t n, uint32_t x, uint8_t y, uint8_t add); /* writes `n` 8-bit values of the textured gradient. */
+  void(*zone)(uint8_t* dst, const uint16_t* phase, uint32_t n, uint16_t add); /* writes `n` 8-bit values of the zone plate. */
+  void(*widen)(uint8_t* dst, const uint8_t* a, const uint8_t* b, uint32_t n, uint16_t factor, uint8_t swap); /* scales 8-bit values into 16-bit samples, interleaved with `b` when set. */
+  const video_generator_kernels* kernels;                 /* the render functions for the format and sample size. */
+  video_generator_color palette[RXS_MAX_COLORS];          /* the background and text box colors. */
+  video_generator_workers* workers;                       /* the render threads, NULL when rendering on the calling thread only. */
 
   /* Audio */
-  uint16_t audio_nchannels;                               /* number of audio channels, for now always 2. */
-  uint8_t  audio_nseconds;                                /* the number of seconds of audio we have in the audio_buffer. Always 4. */
-  uint16_t audio_samplerate;                              /* for now always: 44100 */
+  uint16_t audio_nchannels;                               /* number of interleaved audio channels, 2 by default, at most RXS_MAX_AUDIO_CHANNELS. */
+  uint8_t  audio_nseconds;                                /* length of the bip/bop pattern in seconds. Always 4. */
+  uint32_t audio_samplerate;                              /* 44100 by default. */
+  uint8_t  audio_format;                                  /* one of the VIDEO_GENERATOR_AUDIO_S16, S32 or F32 values. */
+  uint32_t audio_frame_bytes;                             /* number of bytes of one sample for all channels. */
   uint16_t audio_bip_frequency;                           /* frequency for the bip sound, 600hz. */
   uint16_t audio_bop_frequency;                           /* frequency for the bop sound, 300hz. */
   uint32_t audio_bip_millis;                              /* number of millis for the bip sound */
   uint32_t audio_bop_millis;                              /* number of millis for the bop sound */
   size_t   audio_nbytes;                                  /* number of bytes in audio_buffer. */
   uint32_t audio_nsamples;                                /* number of samples that are passed to the audio callback whenever needed. */
-  int16_t* audio_buffer;                                  /* this will contain the audio samples */
+  uint8_t* audio_buffer;                                  /* the samples of one chunk are synthesized into this buffer, see `synth_audio()`. */
   video_generator_audio_callback audio_callback;          /* will be called from the thread when the user needs to process audio. */
+  video_generator_audio_late_callback audio_late_callback; /* is called from the audio thread for each late chunk. */
+  uint8_t  audio_realtime;                                /* is set to 1 by the audio thread when it runs with realtime priority. */
   thread* audio_thread;                                   /* the audio callback is called from another thread to simulate microphone input.*/
-  mutex audio_mutex;                                      /* used to sync. shared data */
   uint8_t audio_thread_must_stop;                         /* is set to 1 when the thread needs to stop */
   uint8_t audio_is_bip;                                   /* is set to 1 as soon as the bip audio part it passed into the callback. */
   uint8_t audio_is_bop;                                   /* is set to 1 as soon as the bop audio part is passed into the callback. */
+  uint8_t  audio_mode;                                    /* one of the VIDEO_GENERATOR_AUDIO_* values. */
+  uint8_t* audio_ring;                                    /* interleaved frames that the audio thread writes in pull mode. */
+  uint32_t audio_ring_frames;                             /* capacity of `audio_ring` in frames, a power of two. */
+  uint64_t audio_ring_write;                              /* total number of frames written into the ring, only changed by the audio thread. */
+  uint64_t audio_ring_read;                               /* total number of frames read from the ring, only changed by the reader. */
+  uint64_t audio_overruns;                                /* number of frames dropped because the ring was full. */
+  uint64_t audio_underruns;                               /* number of frames that were read before they were available. */
+  uint8_t  stats_enabled;                                 /* 1 when the stages are timed, see `video_generator_get_stats()`. */
+  video_generator_stats stats;
+  uint64_t frame_stage_ns[VIDEO_GENERATOR_NUM_STAGES];    /* the stage times of the frame that is being rendered, summed over the render threads. */
+  uint8_t  pace_started;                                  /* 1 after the first call to `video_generator_wait_next_frame()`. */
+  uint64_t pace_start_ns;                                 /* when the first call was made. */
+  uint64_t pace_start_frame;                              /* the frame that was due at `pace_start_ns`. */
+  video_generator_pacing pacing;
+  video_generator_context* context;                       /* the shared render and timer threads, NULL when the generator has its own. */
+  video_generator* timer_next;                            /* the next generator whose audio the timer thread of `context` delivers. */
+  uint64_t audio_pos;                                     /* the first frame of the next audio chunk. */
+  uint64_t audio_chunk;                                   /* index of the next chunk, passed to `audio_late_callback`. */
+  uint64_t audio_deadline;                                /* when the next chunk is due, in ns. */
+  uint64_t audio_period;                                  /* the duration of one chunk, in ns. */
+  uint8_t  audio_prev_is_bip;                             /* `audio_is_bip` of the previous chunk. */
+  uint8_t  audio_prev_is_bop;
+};
+
+/*
+  The start of the shared memory of a frame ring, see "Shared memory
+  ring". Only the generator writes it; the layout is the same for
+  every process on the machine because all members have a fixed size
+  and are naturally aligned.
+*/
+struct video_generator_shm_header {
+  uint32_t magic;                                         /* VIDEO_GENERATOR_SHM_MAGIC, written last so a reader never sees a half written header. */
+  uint32_t version;                                       /* VIDEO_GENERATOR_SHM_VERSION. */
+  uint32_t nslots;                                        /* number of frame slots, at most RXS_MAX_SHM_SLOTS. */
+  uint32_t width;
+  uint32_t height;
+  uint32_t fps;
+  uint32_t format;                                        /* 400, 420, 422, 444 or VIDEO_GENERATOR_FORMAT_NV12. */
+  uint32_t bitdepth;
+  uint32_t byte_order;
+  uint32_t offsets[3];                                    /* where the y, u and v planes start in a slot, the v offset is 0 when there is no v-plane. */
+  uint32_t strides[3];                                    /* bytes between two rows of each plane. */
+  uint32_t plane_bytes[3];                                /* size of each plane, 0 when the format doesn't have it. */
+  uint64_t slot_bytes;                                    /* distance between two slots, a multiple of the page size. */
+  uint64_t slots_offset;                                  /* where the first slot starts, counted from the header. */
+  uint64_t write_count;                                   /* number of published frames; frame `n` of the ring is in slot `n % nslots`. */
+  uint64_t slot_seq[RXS_MAX_SHM_SLOTS];                   /* `n + 1` when the slot holds frame `n` of the ring, 0 while it's being written. */
+  uint64_t slot_frame[RXS_MAX_SHM_SLOTS];                 /* the generator's frame number of what is in the slot. */
+};
+
+/* A mapped frame ring, created by the generator or opened by a reader. */
+struct video_generator_shm {
+  video_generator_shm_header* header;                     /* the start of the mapping, NULL when nothing is mapped. */
+  uint8_t* slots;                                         /* the first slot. */
+  uint64_t nbytes;                                        /* size of the mapping. */
+  uint8_t  is_writer;                                     /* 1 for the ring of `video_generator_shm_create()`, it's removed when closed. */
+  void*    handle;                                        /* the file mapping on Windows. */
+  char     name[RXS_MAX_SHM_NAME];
+  video_generator_dirty dirty[RXS_MAX_SHM_SLOTS];         /* writer: what changed in each slot since it was written before. */
+};
+
+/*
+  Render and timer threads that many generators share, see "Many
+  generators". Set up with `video_generator_context_init()`.
+*/
+struct video_generator_context {
+  uint32_t nthreads;                                      /* number of threads that render a frame, including the calling thread. */
+  video_generator_workers* workers;                       /* the shared render threads, NULL when `nthreads` is 1. */
+  thread* timer_thread;                                   /* delivers the audio chunks of all generators of the context. */
+  mutex timer_mutex;                                      /* protects `timers` and `nusers`, held while chunks are delivered. */
+  video_generator* timers;                                /* the generators with audio, linked by `timer_next`. */
+  uint32_t nusers;                                        /* the number of generators that use the context. */
+  uint8_t  timer_must_stop;                               /* is set to 1 when the timer thread needs to stop. */
+  uint8_t  timer_realtime;                                /* 1 when the timer thread runs with realtime priority. */
+};
+
+struct video_generator_multi {
+  video_generator renditions[RXS_MAX_RENDITIONS];
+  uint32_t count;                                         /* the number of renditions. */
+  uint32_t nthreads;                                      /* the number of threads that render all renditions. */
+  video_generator_workers* workers;
+  video_generator_multi_jobs* jobs;
 };
 
 int video_generator_init(video_generator_settings* cfg, video_generator* g);
 int video_generator_update(video_generator* g);
+int video_generator_next_cached(video_generator* g, const uint8_t** frame);            /* cycle cache: advances like `video_generator_update()` and points `frame` at the cached y, u and v planes. */
+int video_generator_update_into(video_generator* g, uint8_t* planes[3], uint32_t strides[3]); /* renders the next frame into your planes, `strides` in bytes; returns -4 when a stride is too small. */
+int video_generator_acquire_frame(video_generator* g, video_generator_frame** frame);   /* renders the next frame into a free pool buffer, returns -4 when the pool is exhausted. */
+int video_generator_release_frame(video_generator* g, video_generator_frame* frame);    /* makes the buffer available again for `video_generator_acquire_frame()`. */
+int video_generator_update_n(video_generator* g, uint32_t n, video_generator_frame** frames); /* renders the next `n` frames into `frames`, NULL entries get a pool buffer; returns -4 when the pool is exhausted. */
+int video_generator_render_frame(video_generator* g, uint64_t frame, uint8_t* planes[3]); /* renders frame number `frame` into the y, u and v planes without changing the generator. */
 int video_generator_clear(video_generator* g);
+int video_generator_read_frame_id(const uint8_t* y, uint32_t stride, uint8_t bitdepth, uint8_t byte_order, uint64_t* frame, uint64_t* timestamp); /* decodes the frame id from a y-plane, returns -4 when the CRC doesn't match. */
+int video_generator_has_simd(uint8_t level);                                            /* returns 1 when the VIDEO_GENERATOR_SIMD_* level can be used on this cpu. */
+int video_generator_read_audio(video_generator* g, void* dst, uint32_t nframes);        /* pull mode: copies `nframes` interleaved frames in `audio_format` into `dst`, returns the number of frames that were available. */
+int video_generator_get_audio_counters(video_generator* g, uint64_t* overruns, uint64_t* underruns); /* pull mode: the number of dropped and missing frames. */
+int video_generator_get_stats(video_generator* g, video_generator_stats* stats);        /* copies the timings, returns -3 when `stats` wasn't set at init. */
+int video_generator_wait_next_frame(video_generator* g);                                /* sleeps until the next frame is due, returns 1 when it was already late. */
+int video_generator_get_pacing(video_generator* g, video_generator_pacing* pacing);     /* copies the lateness counters of `video_generator_wait_next_frame()`. */
+int video_generator_multi_init(video_generator_settings* cfgs, uint32_t count, uint32_t nthreads, video_generator_multi* m); /* one generator per rendition, see "Renditions". */
+int video_generator_multi_update(video_generator_multi* m);                             /* renders the next frame of every rendition. */
+int video_generator_multi_clear(video_generator_multi* m);
+int video_generator_shm_create(video_generator* g, const char* name, uint32_t nslots, video_generator_shm* shm); /* creates a shared memory ring of `nslots` frames, see "Shared memory ring". */
+int video_generator_shm_update(video_generator* g, video_generator_shm* shm);          /* renders the next frame into the next slot and publishes it. */
+int video_generator_shm_open(const char* name, video_generator_shm* shm);               /* reader: maps the ring read-only, returns -4 when it's not (yet) a ring. */
+int video_generator_shm_latest(video_generator_shm* shm, uint64_t* seq);                /* reader: the ring number of the newest frame, returns -3 when nothing is published yet. */
+int video_generator_shm_peek(video_generator_shm* shm, uint64_t seq, const uint8_t* planes[3], uint64_t* frame); /* reader: points `planes` at frame `seq` of the ring; -3 when it's not published yet, -4 when it's overwritten. */
+int video_generator_shm_check(video_generator_shm* shm, uint64_t seq);                  /* reader: returns 0 when frame `seq` wasn't overwritten while you used it, -4 otherwise. */
+int video_generator_shm_close(video_generator_shm* shm);
+int video_generator_context_init(uint32_t nthreads, uint8_t realtime, video_generator_context* ctx); /* starts `nthreads - 1` render threads and a timer thread that generators can share, see "Many generators". */
+int video_generator_context_clear(video_generator_context* ctx);                       /* stops the threads, returns -2 while generators still use the context. */
+void video_generator_set_log_callback(video_generator_log_callback callback, void* user); /* sends the error messages to `callback` instead of stdout, NULL restores stdout. */
 
 #if defined(__cplusplus)
 } /* extern "C" */